@@ -24,6 +24,28 @@
             vertex_normals:
                 0.577350 0.577350 0.577350 # normal vectors should be written as unit vectors
                 ...                        # (eg always having a length of 1)
+
+            # texture coordinates are listed per vertex, or per index as this
+            # script writes them.
+
+            vertex_texture_coordinates:
+                0.5 1.0
+                ...
+
+            # three indices per triangle, all on one line.
+
+            vertex_indices:
+                0 1 2 ...
+
+            # level_of_detail: sets the screen size of the indices after it,
+            # which are drawn while the mesh covers at least that fraction of
+            # the screen height. after a list of indices it starts another
+            # one, a coarser level over the same vertices.
+            # tools/lmod_optimize adds these.
+
+            level_of_detail: 0.25
+            vertex_indices:
+                0 2 5 ...
 """
 
 import bpy
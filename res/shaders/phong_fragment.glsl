@@ -1,16 +1,17 @@
 #version 410 core
 
+// std140 layout, mirrored by lgl_light_t in lgl.h
 struct light_t {
-  int        type;
   vec3       position;
-  vec3       direction;
   float      cut_off;
+  vec3       direction;
   float      outer_cut_off;
+  vec3       diffuse;
   float      constant;
+  vec3       specular;
   float      linear;
+  int        type;
   float      quadratic;
-  vec3       diffuse;
-  vec3       specular;
 };
 
 struct Material {
@@ -19,20 +20,33 @@ struct Material {
   float      shininess;
 }; 
 
+layout (std140) uniform lgl_camera_block {
+  mat4       u_view;
+  mat4       u_projection;
+  mat4       u_view_projection;
+  vec4       u_camera_position;
+};
+
 in vec3      v_fragment_position;
 in vec3      v_normal;
 in vec2      v_tex_coord;
 
 out vec4     frag_color;
 
-uniform      vec3     u_cameraPos;
 uniform      Material u_material;
 uniform      vec3     u_ambient_light;
 
+// level of detail cross-fade, 0 draws everything. the incoming level gets
+// the fade amount and the outgoing one its negation, so between them every
+// pixel is drawn exactly once
+uniform      float    u_lod_fade;
+
 #define      LIGHTS_MAX 32
 
-uniform      uint    u_lights_count;
-uniform      light_t u_lights[LIGHTS_MAX];
+layout (std140) uniform lgl_lights_block {
+  uint       u_lights_count;
+  light_t    u_lights[LIGHTS_MAX];
+};
 
 vec3 light_directional(light_t light, vec3 normal, vec3 view_direction) {
   vec3 lightDir = normalize(-light.direction);
@@ -121,8 +135,16 @@ vec3 light_spot(light_t light, vec3 normal, vec3 fragment_position, vec3 view_di
 }
 
 void main() {
+  if (u_lod_fade != 0.0) {
+    // interleaved gradient noise, a stable per-pixel threshold
+    float noise = fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+    if ((noise < abs(u_lod_fade)) != (u_lod_fade > 0.0)) {
+      discard;
+    }
+  }
+
   vec3 norm = normalize(v_normal);
-  vec3 view_direction = normalize(u_cameraPos - v_fragment_position);
+  vec3 view_direction = normalize(u_camera_position.xyz - v_fragment_position);
 
   vec3 light = vec3(0,0,0);
   for(int i = 0; i < u_lights_count; i++) {
@@ -0,0 +1,42 @@
+#version 430 core
+
+layout (location = 0) in vec3 a_position;
+layout (location = 1) in vec3 a_normal;
+layout (location = 2) in vec2 a_tex_coord;
+layout (location = 3) in uint a_draw_id;
+
+layout (std140) uniform lgl_camera_block {
+  mat4       u_view;
+  mat4       u_projection;
+  mat4       u_view_projection;
+  vec4       u_camera_position;
+};
+
+struct draw_t {
+  mat4       model;
+  mat3       normal_matrix;
+  vec4       texture_transform; // offset in xy, scale in zw
+  vec4       position_offset;   // xyz, dequantizes positions, see phong_vertex.glsl
+  vec4       position_scale;    // xyz
+};
+
+layout (std430) readonly buffer lgl_draws_block {
+  draw_t     u_draws[];
+};
+
+out vec2 v_tex_coord;
+out vec3 v_normal;
+out vec3 v_fragment_position;
+
+void main(){
+	draw_t draw           = u_draws[a_draw_id];
+	vec3   position       = draw.position_offset.xyz + a_position * draw.position_scale.xyz;
+	vec4   world_position = draw.model * vec4(position, 1.0);
+
+	v_fragment_position = vec3(world_position);
+	v_tex_coord = (a_tex_coord * draw.texture_transform.zw) + draw.texture_transform.xy;
+
+	v_normal = draw.normal_matrix * a_normal;
+
+	gl_Position = u_view_projection * world_position;
+} 
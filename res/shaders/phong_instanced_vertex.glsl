@@ -0,0 +1,34 @@
+#version 410 core
+
+layout (location = 0) in vec3 a_position;
+layout (location = 1) in vec3 a_normal;
+layout (location = 2) in vec2 a_tex_coord;
+layout (location = 3) in mat4 i_model;
+layout (location = 7) in vec4 i_texture_transform; // offset in xy, scale in zw
+layout (location = 8) in mat3 i_normal_matrix;
+
+layout (std140) uniform lgl_camera_block {
+  mat4       u_view;
+  mat4       u_projection;
+  mat4       u_view_projection;
+  vec4       u_camera_position;
+};
+
+// dequantizes positions, see phong_vertex.glsl
+uniform vec3 u_position_offset;
+uniform vec3 u_position_scale;
+
+out vec2 v_tex_coord;
+out vec3 v_normal;
+out vec3 v_fragment_position;
+
+void main(){
+	vec4 world_position = i_model * vec4(u_position_offset + a_position * u_position_scale, 1.0);
+
+	v_fragment_position = vec3(world_position);
+	v_tex_coord = (a_tex_coord * i_texture_transform.zw) + i_texture_transform.xy;
+
+	v_normal = i_normal_matrix * a_normal;
+
+	gl_Position = u_view_projection * world_position;
+} 
@@ -4,20 +4,34 @@ layout (location = 0) in vec3 a_position;
 layout (location = 1) in vec3 a_normal;
 layout (location = 2) in vec2 a_tex_coord;
 
+layout (std140) uniform lgl_camera_block {
+  mat4       u_view;
+  mat4       u_projection;
+  mat4       u_view_projection;
+  vec4       u_camera_position;
+};
+
+// object space = offset + position * scale, packed positions are fractions
+// of the mesh bounds and float ones get offset 0 and scale 1
+uniform vec3 u_position_offset;
+uniform vec3 u_position_scale;
+
 out vec2 v_tex_coord;
 out vec3 v_normal;
 out vec3 v_fragment_position;
 
 uniform vec2 u_texture_offset;
 uniform vec2 u_texture_scale;
-uniform mat4 u_mvp;
+uniform mat4 u_model;
+uniform mat3 u_normal_matrix;
 
 void main(){
-	v_fragment_position = vec3(u_mvp * vec4(a_position, 1.0));
+	vec4 world_position = u_model * vec4(u_position_offset + a_position * u_position_scale, 1.0);
+
+	v_fragment_position = vec3(world_position);
 	v_tex_coord = (a_tex_coord * u_texture_scale) + u_texture_offset;
 
-	//TODO this is EXPENSIVE! do it on the cpu instead
-	v_normal = mat3(transpose(inverse(u_mvp))) * a_normal;
+	v_normal = u_normal_matrix * a_normal;
 
-	gl_Position = u_mvp * vec4(a_position, 1.0);
+	gl_Position = u_view_projection * world_position;
 } 
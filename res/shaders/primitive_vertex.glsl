@@ -2,10 +2,19 @@
 
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 u_modelMatrix;
-uniform mat4 u_viewMatrix;
-uniform mat4 u_projectionMatrix;
+layout (std140) uniform lgl_camera_block {
+  mat4       u_view;
+  mat4       u_projection;
+  mat4       u_view_projection;
+  vec4       u_camera_position;
+};
+
+// dequantizes positions, see phong_vertex.glsl
+uniform vec3 u_position_offset;
+uniform vec3 u_position_scale;
+
+uniform mat4 u_model;
 
 void main(){
-	gl_Position = u_projectionMatrix * u_viewMatrix * u_modelMatrix * vec4(aPos, 1.0);
+	gl_Position = u_view_projection * u_model * vec4(u_position_offset + aPos * u_position_scale, 1.0);
 } 
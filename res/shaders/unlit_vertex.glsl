@@ -3,11 +3,22 @@
 layout (location = 0) in vec3 in_position;
 layout (location = 1) in vec2 in_tex_coord;
 
+layout (std140) uniform lgl_camera_block {
+  mat4       u_view;
+  mat4       u_projection;
+  mat4       u_view_projection;
+  vec4       u_camera_position;
+};
+
 out vec2 v_tex_coord;
 
-uniform mat4 u_mvp;
+// dequantizes positions, see phong_vertex.glsl
+uniform vec3 u_position_offset;
+uniform vec3 u_position_scale;
+
+uniform mat4 u_model;
 
 void main(){
-	gl_Position = u_mvp * vec4(in_position, 1.0);
+	gl_Position = u_view_projection * u_model * vec4(u_position_offset + in_position * u_position_scale, 1.0);
 	v_tex_coord = in_tex_coord;
 } 
@@ -1,4 +1,15 @@
 #include "lgl.h"
+#include "lgl_math.h"
+#include "lgl_mesh.h"
+#include "lgl_lmod.h"
+#include "lgl_ktx.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -12,373 +23,3117 @@ LGL__LEFT    = -0.5,
              LGL__FORWARD =  0.5,
              LGL__BACK    = -0.5;
 
-/*Multiplies a 4x4 matrix with another 4x4 matrix*/
-static inline void lgl__mat4_multiply(
-    float *result,
-    const float *a,
-    const float *b) {
-
-  // row 0
-  result[ 0] = a[ 0] * b[ 0] + a[ 4] * b[ 1] + a[ 8] * b[ 2] + a[12] * b[ 3];
-  result[ 1] = a[ 0] * b[ 1] + a[ 1] * b[ 5] + a[ 2] * b[ 9] + a[ 3] * b[13];
-  result[ 2] = a[ 0] * b[ 2] + a[ 1] * b[ 6] + a[ 2] * b[10] + a[ 3] * b[14];
-  result[ 3] = a[ 0] * b[ 3] + a[ 1] * b[ 7] + a[ 2] * b[11] + a[ 3] * b[15];
-
-  // row 1
-  result[ 4] = a[ 4] * b[ 0] + a[ 5] * b[ 4] + a[ 6] * b[ 8] + a[ 7] * b[12];
-  result[ 5] = a[ 4] * b[ 1] + a[ 5] * b[ 5] + a[ 6] * b[ 9] + a[ 7] * b[13];
-  result[ 6] = a[ 4] * b[ 2] + a[ 5] * b[ 6] + a[ 6] * b[10] + a[ 7] * b[14];
-  result[ 7] = a[ 4] * b[ 3] + a[ 5] * b[ 7] + a[ 6] * b[11] + a[ 7] * b[15];
-
-  // row 2
-  result[ 8] = a[ 8] * b[ 0] + a[ 9] * b[ 4] + a[10] * b[ 8] + a[11] * b[12];
-  result[ 9] = a[ 8] * b[ 1] + a[ 9] * b[ 5] + a[10] * b[ 9] + a[11] * b[13];
-  result[10] = a[ 8] * b[ 2] + a[ 9] * b[ 6] + a[10] * b[10] + a[11] * b[14];
-  result[11] = a[ 8] * b[ 3] + a[ 9] * b[ 7] + a[10] * b[11] + a[11] * b[15];
-
-  // row 3
-  result[12] = a[12] * b[ 0] + a[13] * b[ 4] + a[14] * b[ 8] + a[15] * b[12];
-  result[13] = a[12] * b[ 1] + a[13] * b[ 5] + a[14] * b[ 9] + a[15] * b[13];
-  result[14] = a[12] * b[ 2] + a[13] * b[ 6] + a[14] * b[10] + a[15] * b[14];
-  result[15] = a[12] * b[ 3] + a[13] * b[ 7] + a[14] * b[11] + a[15] * b[15];
+static lgl_stats_t lgl__stats = {0};
+
+lgl_stats_t lgl_stats_get(void) { return lgl__stats; }
+void        lgl_stats_reset(void) { lgl__stats = (lgl_stats_t){0}; }
+
+/*Grows a heap array so it holds at least count elements*/
+static void lgl__reserve(void **array, size_t *capacity, size_t count, size_t size) {
+  if (count <= *capacity) {
+    return;
+  }
+
+  size_t new_capacity = *capacity ? *capacity : 64;
+  while (new_capacity < count) {
+    new_capacity *= 2;
+  }
+
+  *array    = realloc(*array, new_capacity * size);
+  *capacity = new_capacity;
+}
+
+/*Shadow copy of the GL state the renderer changes. Setters skip the driver
+  call when the value would not change. Build with -DLGL_DEBUG_STATE=1 to
+  count the calls that were skipped in lgl_stats_t.*/
+#ifndef LGL_DEBUG_STATE
+#define LGL_DEBUG_STATE 0
+#endif // ifndef LGL_DEBUG_STATE
+
+enum { LGL__TEXTURE_UNITS = 8 };
+
+#define LGL__STATE_UNKNOWN 0xFFFFFFFFu
+
+typedef struct {
+  GLuint         program;
+  GLuint         vertex_array;
+  GLenum         active_texture;
+  GLuint         textures[LGL__TEXTURE_UNITS];
+  GLenum         polygon_mode;
+  GLuint         stencil_mask;
+  GLenum         stencil_func;
+  GLint          stencil_ref;
+  GLuint         stencil_func_mask;
+  GLuint         blend;
+  GLuint         depth_mask;
+} lgl__state_t;
+
+static lgl__state_t lgl__state = {
+  .program           = LGL__STATE_UNKNOWN,
+  .vertex_array      = LGL__STATE_UNKNOWN,
+  .active_texture    = LGL__STATE_UNKNOWN,
+  .textures          = {
+    LGL__STATE_UNKNOWN, LGL__STATE_UNKNOWN, LGL__STATE_UNKNOWN, LGL__STATE_UNKNOWN,
+    LGL__STATE_UNKNOWN, LGL__STATE_UNKNOWN, LGL__STATE_UNKNOWN, LGL__STATE_UNKNOWN,
+  },
+  .polygon_mode      = LGL__STATE_UNKNOWN,
+  .stencil_mask      = LGL__STATE_UNKNOWN,
+  .stencil_func      = LGL__STATE_UNKNOWN,
+  .stencil_ref       = -1,
+  .stencil_func_mask = LGL__STATE_UNKNOWN,
+  .blend             = LGL__STATE_UNKNOWN,
+  .depth_mask        = LGL__STATE_UNKNOWN,
+};
+
+void lgl_state_invalidate(void) {
+  memset(&lgl__state, 0xFF, sizeof(lgl__state));
+}
+
+#if LGL_DEBUG_STATE
+#define LGL__STATE_REDUNDANT() (lgl__stats.redundant_state_calls++)
+#else
+#define LGL__STATE_REDUNDANT() ((void)0)
+#endif // LGL_DEBUG_STATE
+
+/*Compares and updates one shadowed value. Evaluates to 1 when the driver call
+  is needed.*/
+#define LGL__STATE_CHANGE(field, value)                                      \
+  (lgl__state.field == (value) ? (LGL__STATE_REDUNDANT(), 0)                 \
+                               : (lgl__state.field = (value), 1))
+
+static inline void lgl__use_program(GLuint program) {
+  if (LGL__STATE_CHANGE(program, program)) {
+    glUseProgram(program);
+  }
+}
+
+static inline void lgl__bind_vertex_array(GLuint vertex_array) {
+  if (LGL__STATE_CHANGE(vertex_array, vertex_array)) {
+    glBindVertexArray(vertex_array);
+  }
+}
+
+static inline void lgl__bind_texture(GLuint unit, GLuint texture) {
+  if (LGL__STATE_CHANGE(textures[unit], texture)) {
+    if (LGL__STATE_CHANGE(active_texture, GL_TEXTURE0 + unit)) {
+      glActiveTexture(GL_TEXTURE0 + unit);
+    }
+    glBindTexture(GL_TEXTURE_2D, texture);
+  }
+}
+
+static inline void lgl__polygon_mode(GLenum mode) {
+  if (LGL__STATE_CHANGE(polygon_mode, mode)) {
+    glPolygonMode(GL_FRONT_AND_BACK, mode);
+  }
+}
+
+static inline void lgl__stencil_mask(GLuint mask) {
+  if (LGL__STATE_CHANGE(stencil_mask, mask)) {
+    glStencilMask(mask);
+  }
+}
+
+static inline void lgl__stencil_func(GLenum func, GLint ref, GLuint mask) {
+  if (lgl__state.stencil_func      == func &&
+      lgl__state.stencil_ref       == ref  &&
+      lgl__state.stencil_func_mask == mask) {
+    LGL__STATE_REDUNDANT();
+    return;
+  }
+
+  lgl__state.stencil_func      = func;
+  lgl__state.stencil_ref       = ref;
+  lgl__state.stencil_func_mask = mask;
+  glStencilFunc(func, ref, mask);
+}
+
+static inline void lgl__blend(GLuint enabled) {
+  if (LGL__STATE_CHANGE(blend, enabled)) {
+    if (enabled) {
+      glEnable(GL_BLEND);
+    } else {
+      glDisable(GL_BLEND);
+    }
+  }
+}
+
+static inline void lgl__depth_mask(GLuint enabled) {
+  if (LGL__STATE_CHANGE(depth_mask, enabled)) {
+    glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+  }
+}
+
+/*Uniform buffer binding points shared by every program*/
+enum {
+  LGL__BINDING_LIGHTS,
+  LGL__BINDING_DRAWS,
+  LGL__BINDING_CAMERA,
+};
+
+/*std140 layout of lgl_lights_block in phong_fragment.glsl*/
+typedef struct {
+  GLuint         lights_count;
+  GLuint         _padding[3];
+  lgl_light_t    lights[LGL_LIGHTS_MAX];
+} lgl__lights_block_t;
+
+static GLuint lgl__lights_buffer = 0;
+
+void lgl_lights_upload(const size_t lights_count, const lgl_light_t *lights) {
+  if (lgl__lights_buffer == 0) {
+    glGenBuffers    (1, &lgl__lights_buffer);
+    glBindBuffer    (GL_UNIFORM_BUFFER, lgl__lights_buffer);
+    glBufferData    (GL_UNIFORM_BUFFER, sizeof(lgl__lights_block_t), NULL, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, LGL__BINDING_LIGHTS, lgl__lights_buffer);
+  }
+
+  GLuint count = lights_count;
+  if (count > LGL_LIGHTS_MAX) {
+    debug_warn("%lu lights uploaded but only %d are supported", lights_count, LGL_LIGHTS_MAX);
+    count = LGL_LIGHTS_MAX;
+  }
+
+  glBindBuffer   (GL_UNIFORM_BUFFER, lgl__lights_buffer);
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(count), &count);
+  glBufferSubData(GL_UNIFORM_BUFFER,
+      offsetof(lgl__lights_block_t, lights),
+      count * sizeof(lgl_light_t),
+      lights);
+  glBindBuffer   (GL_UNIFORM_BUFFER, 0);
+}
+
+/*Every uniform location the renderer touches, looked up once per program*/
+typedef struct {
+  GLuint                program;
+  GLint                 model;
+  GLint                 normal_matrix;
+  GLint                 texture_offset;
+  GLint                 texture_scale;
+  GLint                 material_diffuse;
+  GLint                 material_specular;
+  GLint                 material_shininess;
+  GLint                 ambient_light;
+  GLint                 color;
+  GLint                 lod_fade;
+  GLint                 position_offset;
+  GLint                 position_scale;
+} lgl__uniforms_t;
+
+enum { LGL__SHADERS_MAX = 64 }; // must be a power of two
+
+static lgl__uniforms_t lgl__uniforms[LGL__SHADERS_MAX] = {0};
+
+static inline GLint lgl__uniform_location(GLuint program, const char *name) {
+  lgl__stats.uniform_lookups++;
+  return glGetUniformLocation(program, name);
+}
+
+static void lgl__uniforms_build(lgl__uniforms_t *u, GLuint program) {
+  u->program            = program;
+  u->model              = lgl__uniform_location(program, "u_model");
+  u->normal_matrix      = lgl__uniform_location(program, "u_normal_matrix");
+  u->texture_offset     = lgl__uniform_location(program, "u_texture_offset");
+  u->texture_scale      = lgl__uniform_location(program, "u_texture_scale");
+  u->material_diffuse   = lgl__uniform_location(program, "u_material.diffuse");
+  u->material_specular  = lgl__uniform_location(program, "u_material.specular");
+  u->material_shininess = lgl__uniform_location(program, "u_material.shininess");
+  u->ambient_light      = lgl__uniform_location(program, "u_ambient_light");
+  u->color              = lgl__uniform_location(program, "u_color");
+  u->lod_fade           = lgl__uniform_location(program, "u_lod_fade");
+  u->position_offset    = lgl__uniform_location(program, "u_position_offset");
+  u->position_scale     = lgl__uniform_location(program, "u_position_scale");
+
+  // material properties that are the same for every object
+  lgl__use_program(program);
+  glUniform1i(u->material_diffuse,   0);
+  glUniform1i(u->material_specular,  1);
+  glUniform1f(u->material_shininess, 8.0f);
+  glUniform3f(u->ambient_light,      0.2, 0.2, 0.2);
+
+  GLuint lights_block = glGetUniformBlockIndex(program, "lgl_lights_block");
+  if (lights_block != GL_INVALID_INDEX) {
+    glUniformBlockBinding(program, lights_block, LGL__BINDING_LIGHTS);
+  }
+
+  GLuint camera_block = glGetUniformBlockIndex(program, "lgl_camera_block");
+  if (camera_block != GL_INVALID_INDEX) {
+    glUniformBlockBinding(program, camera_block, LGL__BINDING_CAMERA);
+  }
+
+  if (GLAD_GL_VERSION_4_3) {
+    GLuint draws_block = glGetProgramResourceIndex(program, GL_SHADER_STORAGE_BLOCK, "lgl_draws_block");
+    if (draws_block != GL_INVALID_INDEX) {
+      glShaderStorageBlockBinding(program, draws_block, LGL__BINDING_DRAWS);
+    }
+  }
+}
+
+/*Returns the cached uniform locations for a program. Programs that did not
+  come from lgl_shader_link are added to the cache the first time they are
+  seen.*/
+static const lgl__uniforms_t *lgl__uniforms_get(GLuint program) {
+  size_t slot = program & (LGL__SHADERS_MAX - 1);
+  for(size_t probe = 0; probe < LGL__SHADERS_MAX; probe++) {
+    lgl__uniforms_t *u = &lgl__uniforms[(slot + probe) & (LGL__SHADERS_MAX - 1)];
+    if (u->program == program) {
+      return u;
+    }
+    if (u->program == 0) {
+      lgl__uniforms_build(u, program);
+      return u;
+    }
+  }
+
+  debug_warn("uniform cache is full, evicting a program to make room");
+  lgl__uniforms_build(&lgl__uniforms[slot], program);
+  return &lgl__uniforms[slot];
+}
+
+void lgl_perspective(
+    float *mat,
+    const float fov,
+    const float aspect,
+    const float near,
+    const float far) {
+
+  const float cotan = (1.0 / tanf(fov * 0.5));
+
+  mat[ 0]  = (cotan / aspect);
+  mat[ 5]  = cotan;
+  mat[10]  = -((near + far) / (near - far));
+  mat[11]  = 1.0f;
+  mat[14]  = ((2.0 * near * far) / (near - far));
+}
+
+/*std140 layout of lgl_camera_block, shared by every shader*/
+typedef struct {
+  GLfloat        view[16];
+  GLfloat        projection[16];
+  GLfloat        view_projection[16];
+  lgl_4f_t       position;
+} lgl__camera_block_t;
+
+static GLuint       lgl__camera_buffer = 0;
+
+/*The camera from the last lgl_camera_update, used for depth sorting and
+  culling. Nothing is culled until the first update.*/
+static int          lgl__camera_active = 0;
+static lgl_camera_t lgl__camera = {
+  .view = {
+    1.0,  0.0,  0.0,  0.0,
+    0.0,  1.0,  0.0,  0.0,
+    0.0,  0.0,  1.0,  0.0,
+    0.0,  0.0,  0.0,  1.0,
+  },
+};
+
+lgl_camera_t lgl_camera_alloc(void) {
+  lgl_camera_t camera = {0};
+  camera.position     = lgl_3f_zero();
+  camera.rotation     = lgl_4f_zero();
+  camera.fov          = 80 * (3.14159/180.0);
+  camera.aspect       = 640.0 / 480.0;
+  camera.near         = 0.001;
+  camera.far          = 1000;
+  return camera;
+}
+
+void lgl_camera_update(lgl_camera_t *camera) {
+  { // view, the inverse of the camera's rotation and translation
+    GLfloat rotation[16];
+    lgl_mat4_trs(rotation, NULL, lgl_3f_zero(), camera->rotation, lgl_3f_one(1.0));
+
+    const lgl_3f_t p = camera->position;
+    GLfloat *view = camera->view;
+
+    view[ 0] = rotation[0]; view[ 4] = rotation[1]; view[ 8] = rotation[ 2];
+    view[ 1] = rotation[4]; view[ 5] = rotation[5]; view[ 9] = rotation[ 6];
+    view[ 2] = rotation[8]; view[ 6] = rotation[9]; view[10] = rotation[10];
+    view[ 3] = 0;           view[ 7] = 0;           view[11] = 0;
+
+    view[12] = -(rotation[0] * p.x + rotation[1] * p.y + rotation[ 2] * p.z);
+    view[13] = -(rotation[4] * p.x + rotation[5] * p.y + rotation[ 6] * p.z);
+    view[14] = -(rotation[8] * p.x + rotation[9] * p.y + rotation[10] * p.z);
+    view[15] = 1;
+  }
+
+  memset(camera->projection, 0, sizeof(camera->projection));
+  lgl_perspective(camera->projection, camera->fov, camera->aspect, camera->near, camera->far);
+
+  lgl_mat4_multiply(camera->view_projection, camera->projection, camera->view);
+  lgl_frustum_planes(camera->frustum, camera->view_projection);
+
+  { // with a tiny near plane the extracted far plane loses most of its
+    // precision, so it is rebuilt from the view direction instead
+    const GLfloat *view = camera->view;
+    const lgl_3f_t forward = { view[2], view[6], view[10] };
+    const lgl_3f_t p       = camera->position;
+    camera->frustum[5] = (lgl_4f_t) {
+      -forward.x, -forward.y, -forward.z,
+      camera->far + forward.x * p.x + forward.y * p.y + forward.z * p.z,
+    };
+  }
+
+  lgl__camera_block_t block = {0};
+  memcpy(block.view,            camera->view,            sizeof(block.view));
+  memcpy(block.projection,      camera->projection,      sizeof(block.projection));
+  memcpy(block.view_projection, camera->view_projection, sizeof(block.view_projection));
+  block.position = (lgl_4f_t) { camera->position.x, camera->position.y, camera->position.z, 1.0 };
+
+  if (lgl__camera_buffer == 0) {
+    glGenBuffers    (1, &lgl__camera_buffer);
+    glBindBuffer    (GL_UNIFORM_BUFFER, lgl__camera_buffer);
+    glBufferData    (GL_UNIFORM_BUFFER, sizeof(block), NULL, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, LGL__BINDING_CAMERA, lgl__camera_buffer);
+  }
+
+  glBindBuffer   (GL_UNIFORM_BUFFER, lgl__camera_buffer);
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(block), &block);
+  glBindBuffer   (GL_UNIFORM_BUFFER, 0);
+
+  lgl__camera        = *camera;
+  lgl__camera_active = 1;
+}
+
+static lgl_transforms_t lgl__transforms = {0};
+
+static const GLfloat LGL__IDENTITY[16] = {
+  1.0, 0.0, 0.0, 0.0,
+  0.0, 1.0, 0.0, 0.0,
+  0.0, 0.0, 1.0, 0.0,
+  0.0, 0.0, 0.0, 1.0,
+};
+
+lgl_transforms_t *lgl_transforms(void) { return &lgl__transforms; }
+
+void lgl_transforms_dirty(const size_t index) {
+  lgl_transforms_t *t = &lgl__transforms;
+  t->dirty[index] = 1;
+  if (index < t->dirty_first) {
+    t->dirty_first = index;
+  }
+}
+
+static inline size_t lgl__transform_index(lgl_transform_t transform) {
+  return lgl__transforms.slots[transform - 1];
+}
+
+/*NONE, handles past the slots ever handed out and freed handles are logged.
+  A freed slot holds a free list link rather than an index, so a slot is only
+  live when the index it holds points back at its handle.*/
+static inline int lgl__transform_exists(lgl_transform_t transform) {
+  const lgl_transforms_t *t = &lgl__transforms;
+  if (transform == LGL_TRANSFORM_NONE || transform > t->slots_count) {
+    debug_error("transform %u does not exist", transform);
+    return 0;
+  }
+  const size_t index = t->slots[transform - 1];
+  if (index >= t->count || t->handles[index] != transform) {
+    debug_error("transform %u was freed", transform);
+    return 0;
+  }
+  return 1;
+}
+
+lgl_transform_t lgl_transform_alloc(void) {
+  lgl_transforms_t *t = &lgl__transforms;
+
+  if (t->count == t->capacity) {
+    size_t capacity = t->capacity ? t->capacity * 2 : 64;
+    t->positions = realloc(t->positions, capacity * sizeof(*t->positions));
+    t->rotations = realloc(t->rotations, capacity * sizeof(*t->rotations));
+    t->scales    = realloc(t->scales,    capacity * sizeof(*t->scales));
+    t->models    = realloc(t->models,    capacity * sizeof(*t->models)  * 16);
+    t->normals   = realloc(t->normals,   capacity * sizeof(*t->normals) * 12);
+    t->parents   = realloc(t->parents,   capacity * sizeof(*t->parents));
+    t->dirty     = realloc(t->dirty,     capacity * sizeof(*t->dirty));
+    t->handles   = realloc(t->handles,   capacity * sizeof(*t->handles));
+    t->capacity  = capacity;
+  }
+
+  uint32_t handle = t->slots_free;
+  if (handle) {
+    t->slots_free = t->slots[handle - 1];
+  } else {
+    lgl__reserve((void**)&t->slots, &t->slots_capacity, t->slots_count + 1, sizeof(*t->slots));
+    handle = ++t->slots_count;
+  }
+
+  // roots go at the end, which keeps parents in front of their children
+  const size_t index = t->count++;
+  t->slots[handle - 1] = index;
+  t->handles[index]    = handle;
+  t->positions[index]  = lgl_3f_zero();
+  t->rotations[index]  = lgl_4f_zero();
+  t->scales[index]     = lgl_3f_one(1.0);
+  t->parents[index]    = LGL_TRANSFORM_NONE;
+  lgl_transforms_dirty(index);
+
+  return handle;
+}
+
+/*Children of a freed transform become roots. The last transform moves into
+  the freed index so the arrays stay packed, which can put it in front of
+  its parent, so the order is rebuilt on the next update.*/
+void lgl_transform_free(lgl_transform_t transform) {
+  lgl_transforms_t *t = &lgl__transforms;
+  if (transform == LGL_TRANSFORM_NONE) {
+    return;
+  }
+  if (!lgl__transform_exists(transform)) {
+    return;
+  }
+
+  for(size_t i = 0; i < t->count; i++) {
+    if (t->parents[i] == transform) {
+      t->parents[i] = LGL_TRANSFORM_NONE;
+      lgl_transforms_dirty(i);
+    }
+  }
+
+  const size_t index = t->slots[transform - 1];
+  const size_t last  = --t->count;
+
+  if (index != last) {
+    t->positions[index] = t->positions[last];
+    t->rotations[index] = t->rotations[last];
+    t->scales[index]    = t->scales[last];
+    memcpy(&t->models [index * 16], &t->models [last * 16], 16 * sizeof(*t->models));
+    memcpy(&t->normals[index * 12], &t->normals[last * 12], 12 * sizeof(*t->normals));
+    t->parents[index]   = t->parents[last];
+    t->dirty[index]     = t->dirty[last];
+    t->handles[index]   = t->handles[last];
+    t->slots[t->handles[index] - 1] = index;
+
+    if (t->dirty[index]) {
+      lgl_transforms_dirty(index);
+    }
+    if (t->parents[index] != LGL_TRANSFORM_NONE) {
+      t->reorder = 1;
+    }
+  }
+
+  t->slots[transform - 1] = t->slots_free;
+  t->slots_free           = transform;
+}
+
+size_t lgl_transform_index(lgl_transform_t transform) {
+  if (!lgl__transform_exists(transform)) {
+    return SIZE_MAX;
+  }
+  return lgl__transform_index(transform);
+}
+
+void lgl_transform_parent_set(lgl_transform_t transform, lgl_transform_t parent) {
+  lgl_transforms_t *t = &lgl__transforms;
+  if (!lgl__transform_exists(transform) ||
+      (parent != LGL_TRANSFORM_NONE && !lgl__transform_exists(parent))) {
+    return;
+  }
+
+  for(lgl_transform_t ancestor = parent; ancestor != LGL_TRANSFORM_NONE;
+      ancestor = t->parents[lgl__transform_index(ancestor)]) {
+    if (ancestor == transform) {
+      debug_warn("transform %u can not be parented to its own descendant %u", transform, parent);
+      return;
+    }
+  }
+
+  const size_t index = lgl__transform_index(transform);
+  t->parents[index]  = parent;
+  t->reorder         = 1;
+  lgl_transforms_dirty(index);
+}
+
+lgl_transform_t lgl_transform_parent(lgl_transform_t transform) {
+  if (!lgl__transform_exists(transform)) {
+    return LGL_TRANSFORM_NONE;
+  }
+  return lgl__transforms.parents[lgl__transform_index(transform)];
+}
+
+lgl_3f_t lgl_transform_position(lgl_transform_t transform) {
+  if (!lgl__transform_exists(transform)) {
+    return lgl_3f_zero();
+  }
+  return lgl__transforms.positions[lgl__transform_index(transform)];
+}
+
+lgl_4f_t lgl_transform_rotation(lgl_transform_t transform) {
+  if (!lgl__transform_exists(transform)) {
+    return lgl_4f_zero();
+  }
+  return lgl__transforms.rotations[lgl__transform_index(transform)];
+}
+
+lgl_3f_t lgl_transform_scale(lgl_transform_t transform) {
+  if (!lgl__transform_exists(transform)) {
+    return lgl_3f_one(1.0);
+  }
+  return lgl__transforms.scales[lgl__transform_index(transform)];
+}
+
+void lgl_transform_position_set(lgl_transform_t transform, const lgl_3f_t position) {
+  if (!lgl__transform_exists(transform)) {
+    return;
+  }
+  const size_t index = lgl__transform_index(transform);
+  lgl__transforms.positions[index] = position;
+  lgl_transforms_dirty(index);
+}
+
+void lgl_transform_rotation_set(lgl_transform_t transform, const lgl_4f_t rotation) {
+  if (!lgl__transform_exists(transform)) {
+    return;
+  }
+  const size_t index = lgl__transform_index(transform);
+  lgl__transforms.rotations[index] = rotation;
+  lgl_transforms_dirty(index);
+}
+
+void lgl_transform_scale_set(lgl_transform_t transform, const lgl_3f_t scale) {
+  if (!lgl__transform_exists(transform)) {
+    return;
+  }
+  const size_t index = lgl__transform_index(transform);
+  lgl__transforms.scales[index] = scale;
+  lgl_transforms_dirty(index);
+}
+
+/*Reorders a heap array so element i is the old element order[i]*/
+static void lgl__permute(
+    void        **array,
+    const size_t  size,
+    const size_t *order,
+    const size_t  count,
+    const size_t  capacity) {
+  unsigned char *source = *array;
+  unsigned char *sorted = malloc(capacity * size);
+  for(size_t i = 0; i < count; i++) {
+    memcpy(&sorted[i * size], &source[order[i] * size], size);
+  }
+  free(source);
+  *array = sorted;
+}
+
+/*Stable counting sort of the store by depth in the hierarchy. Every parent
+  ends up in front of its children and roots come first.*/
+static void lgl__transforms_sort(void) {
+  lgl_transforms_t *t = &lgl__transforms;
+  const size_t count = t->count;
+
+  size_t *depths = calloc(count, sizeof(*depths));
+  size_t *order  = calloc(count, sizeof(*order));
+
+  size_t depth_max = 0;
+  for(size_t i = 0; i < count; i++) {
+    for(lgl_transform_t parent = t->parents[i]; parent != LGL_TRANSFORM_NONE;
+        parent = t->parents[lgl__transform_index(parent)]) {
+      depths[i]++;
+    }
+    if (depths[i] > depth_max) {
+      depth_max = depths[i];
+    }
+  }
+
+  size_t *offsets = calloc(depth_max + 2, sizeof(*offsets));
+  for(size_t i = 0; i < count; i++) {
+    offsets[depths[i] + 1]++;
+  }
+  for(size_t depth = 1; depth <= depth_max + 1; depth++) {
+    offsets[depth] += offsets[depth - 1];
+  }
+  for(size_t i = 0; i < count; i++) {
+    order[offsets[depths[i]]++] = i;
+  }
+
+  lgl__permute((void**)&t->positions, sizeof(*t->positions),      order, count, t->capacity);
+  lgl__permute((void**)&t->rotations, sizeof(*t->rotations),      order, count, t->capacity);
+  lgl__permute((void**)&t->scales,    sizeof(*t->scales),         order, count, t->capacity);
+  lgl__permute((void**)&t->models,    sizeof(*t->models)  * 16,   order, count, t->capacity);
+  lgl__permute((void**)&t->normals,   sizeof(*t->normals) * 12,   order, count, t->capacity);
+  lgl__permute((void**)&t->parents,   sizeof(*t->parents),        order, count, t->capacity);
+  lgl__permute((void**)&t->dirty,     sizeof(*t->dirty),          order, count, t->capacity);
+  lgl__permute((void**)&t->handles,   sizeof(*t->handles),        order, count, t->capacity);
+
+  for(size_t i = 0; i < count; i++) {
+    t->slots[t->handles[i] - 1] = i;
+  }
+
+  free(depths);
+  free(order);
+  free(offsets);
+
+  t->reorder     = 0;
+  t->dirty_first = 0;
+}
+
+/*One pass over the store from the first dirty transform. A child is
+  recomputed when it or any ancestor is dirty, parents are always finished
+  first since they come earlier. Runs of dirty roots go through the batch
+  kernel.*/
+void lgl_transforms_update(void) {
+  lgl_transforms_t *t = &lgl__transforms;
+
+  if (t->reorder) {
+    lgl__transforms_sort();
+  }
+
+  if (t->dirty_first >= t->count) {
+    return;
+  }
+
+  size_t i = t->dirty_first;
+  while (i < t->count) {
+    const lgl_transform_t parent = t->parents[i];
+
+    if (parent == LGL_TRANSFORM_NONE) {
+      size_t end = i;
+      while (end < t->count && t->dirty[end] && t->parents[end] == LGL_TRANSFORM_NONE) {
+        end++;
+      }
+
+      if (end > i) {
+        lgl_mat4_trs_batch(end - i, &t->models[i * 16], &t->normals[i * 12],
+            &t->positions[i], &t->rotations[i], &t->scales[i]);
+        i = end;
+      } else {
+        i++;
+      }
+      continue;
+    }
+
+    const size_t parent_index = lgl__transform_index(parent);
+    t->dirty[i] |= t->dirty[parent_index];
+
+    if (t->dirty[i]) {
+      GLfloat *model = &t->models[i * 16];
+      lgl_mat4_trs(model, NULL, t->positions[i], t->rotations[i], t->scales[i]);
+      lgl_mat4_multiply(model, &t->models[parent_index * 16], model);
+      lgl_mat3_inverse_transpose(&t->normals[i * 12], model);
+    }
+    i++;
+  }
+
+  memset(&t->dirty[t->dirty_first], 0, t->count - t->dirty_first);
+  t->dirty_first = SIZE_MAX;
+}
+
+/*World and normal matrix of a render data's transform*/
+static inline const GLfloat *lgl__transform_model(lgl_transform_t transform) {
+  if (transform == LGL_TRANSFORM_NONE) {
+    return LGL__IDENTITY;
+  }
+  return &lgl__transforms.models[lgl__transform_index(transform) * 16];
+}
+
+static inline const GLfloat *lgl__transform_normal(lgl_transform_t transform) {
+  if (transform == LGL_TRANSFORM_NONE) {
+    return LGL__IDENTITY; // the first three vec4 columns of identity
+  }
+  return &lgl__transforms.normals[lgl__transform_index(transform) * 12];
+}
+
+const GLfloat *lgl_transform_model(lgl_transform_t transform) {
+  return lgl__transform_model(transform);
+}
+
+/*Creates a texture with the parameters every texture gets, bound to unit 0*/
+static GLuint lgl__texture_create(void) {
+  GLuint texture;
+  glGenTextures(1, &texture);
+  lgl__bind_texture(0, texture);
+
+  /*set parameters*/
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  return texture;
+}
+
+/*Fills the texture bound to unit 0 from decoded pixels and builds its
+  mipmaps. pixels is an offset instead while a pixel unpack buffer is
+  bound. Images that are not RGB or RGBA are left out.*/
+static void lgl__texture_image(
+    const int            width,
+    const int            height,
+    const int            channels,
+    const unsigned char *pixels) {
+  // rows are tightly packed, an RGB row need not be a multiple of 4 bytes
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  if (channels == 4) {
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height,
+        0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    glGenerateMipmap(GL_TEXTURE_2D);
+  } else if (channels == 3) {
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0,
+        GL_RGB, GL_UNSIGNED_BYTE, pixels);
+    glGenerateMipmap(GL_TEXTURE_2D);
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+/*Pixel unpack buffers texture uploads rotate through. Each one carries a
+  fence for the last upload read out of it, so it is only written again
+  once the GPU is done with it.*/
+static struct {
+  GLuint  buffers[LGL_PIXEL_BUFFERS];
+  size_t  capacities[LGL_PIXEL_BUFFERS];
+  GLsync  fences[LGL_PIXEL_BUFFERS];
+  size_t  current;
+  int     mapped;      // current is mapped and waiting for an upload
+} lgl__pixel_buffers = {0};
+
+void *lgl_pixels_map(const size_t size) {
+  if (lgl__pixel_buffers.mapped) {
+    debug_error("pixels are already mapped, upload them before mapping more");
+    return NULL;
+  }
+  if (size == 0) {
+    return NULL;
+  }
+
+  const size_t slot = lgl__pixel_buffers.current;
+  if (lgl__pixel_buffers.buffers[slot] == 0) {
+    glGenBuffers(1, &lgl__pixel_buffers.buffers[slot]);
+  }
+
+  GLsync fence = lgl__pixel_buffers.fences[slot];
+  if (fence) {
+    // only stalls when every buffer of the ring is still being read
+    GLenum status;
+    do {
+      status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+    } while (status == GL_TIMEOUT_EXPIRED);
+    glDeleteSync(fence);
+    lgl__pixel_buffers.fences[slot] = NULL;
+  }
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, lgl__pixel_buffers.buffers[slot]);
+  if (lgl__pixel_buffers.capacities[slot] < size) {
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+    lgl__pixel_buffers.capacities[slot] = size;
+  }
+
+  // the fence already covered the buffer, so the driver need not sync again
+  void *pixels = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+  if (pixels == NULL) {
+    debug_error("Failed to map %zu bytes of pixel unpack buffer", size);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return NULL;
+  }
+
+  lgl__pixel_buffers.mapped = 1;
+  return pixels;
+}
+
+/*Unmaps the current buffer and leaves it bound, so texture calls read from
+  it at offset 0*/
+static int lgl__pixels_unpack_begin(void) {
+  if (!lgl__pixel_buffers.mapped) {
+    debug_error("No pixels are mapped, see lgl_pixels_map");
+    return 0;
+  }
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, lgl__pixel_buffers.buffers[lgl__pixel_buffers.current]);
+  lgl__pixel_buffers.mapped = 0;
+  if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_FALSE) {
+    debug_warn("Pixel unpack buffer contents were lost, skipping upload");
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return 0;
+  }
+  return 1;
+}
+
+/*Fences the reads just issued and moves on to the next buffer*/
+static void lgl__pixels_unpack_end(void) {
+  const size_t slot = lgl__pixel_buffers.current;
+  lgl__pixel_buffers.fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  lgl__pixel_buffers.current = (slot + 1) % LGL_PIXEL_BUFFERS;
+}
+
+void lgl_texture_image(
+    const GLuint texture,
+    const int    width,
+    const int    height,
+    const int    channels) {
+  if (!lgl__pixels_unpack_begin()) {
+    return;
+  }
+
+  lgl__bind_texture(0, texture);
+  lgl__texture_image(width, height, channels, NULL);
+  lgl__bind_texture(0, 0);
+  lgl__pixels_unpack_end();
+}
+
+void lgl_texture_update(
+    const GLuint texture,
+    const int    x,
+    const int    y,
+    const int    width,
+    const int    height,
+    const int    channels) {
+  if (!lgl__pixels_unpack_begin()) {
+    return;
+  }
+
+  const GLenum format = channels == 4 ? GL_RGBA : GL_RGB;
+  lgl__bind_texture(0, texture);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // tightly packed, see lgl__texture_image
+  glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, format, GL_UNSIGNED_BYTE, NULL);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  lgl__bind_texture(0, 0);
+  lgl__pixels_unpack_end();
+}
+
+void lgl_pixel_buffers_free(void) {
+  if (lgl__pixel_buffers.mapped) {
+    lgl__pixels_unpack_begin();
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  }
+
+  for(size_t i = 0; i < LGL_PIXEL_BUFFERS; i++) {
+    if (lgl__pixel_buffers.fences[i]) {
+      glDeleteSync(lgl__pixel_buffers.fences[i]);
+    }
+  }
+  glDeleteBuffers(LGL_PIXEL_BUFFERS, lgl__pixel_buffers.buffers);
+  memset(&lgl__pixel_buffers, 0, sizeof(lgl__pixel_buffers));
+}
+
+/*Uploads decoded pixels through the pixel buffer ring into texture and
+  builds its mipmaps, straight from client memory if no buffer could be
+  mapped*/
+static void lgl__texture_stream(
+    const GLuint         texture,
+    const int            width,
+    const int            height,
+    const int            channels,
+    const unsigned char *pixels) {
+  const size_t size   = (size_t)width * height * channels;
+  void        *mapped = channels == 3 || channels == 4 ? lgl_pixels_map(size) : NULL;
+  if (mapped) {
+    memcpy(mapped, pixels, size);
+    lgl_texture_image(texture, width, height, channels);
+    return;
+  }
+
+  lgl__bind_texture(0, texture);
+  lgl__texture_image(width, height, channels, pixels);
+  lgl__bind_texture(0, 0);
+}
+
+static int lgl__texture_is_ktx(const char *path) {
+  const size_t length = strlen(path);
+  return length >= 4 && strcmp(path + length - 4, ".ktx") == 0;
+}
+
+/*Whether the driver samples a KTX format as it is stored*/
+static int lgl__texture_ktx_supported(const GLenum format) {
+  switch (format) {
+    case LGL_KTX_BC1:
+    case LGL_KTX_BC3: return GLAD_GL_EXT_texture_compression_s3tc;
+    case LGL_KTX_BC7: return GLAD_GL_VERSION_4_2 || GLAD_GL_ARB_texture_compression_bptc;
+    default:          return 1;
+  }
+}
+
+/*Reads a .ktx file, see tools/texture_bake.c. Levels in a format the driver
+  cannot sample are decoded to RGBA8 here, which is the slow part, so this
+  runs on the loader threads too. Returns the memory ktx's levels point
+  into, or NULL if the file failed to load.*/
+static uint8_t *lgl__texture_ktx_read(const char *path, lgl_ktx_t *ktx) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    return NULL;
+  }
+
+  fseek(file, 0, SEEK_END);
+  const long length = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  uint8_t  *data = malloc(length > 0 ? length : 1);
+  const int read = length > 0 && fread(data, 1, length, file) == (size_t)length;
+  fclose(file);
+  if (!read || !lgl_ktx_parse(data, length, ktx)) {
+    free(data);
+    return NULL;
+  }
+  if (lgl__texture_ktx_supported(ktx->format)) {
+    return data;
+  }
+
+  size_t size = 0;
+  for(uint32_t i = 0; i < ktx->levels_count; i++) {
+    size += lgl_ktx_size(LGL_KTX_RGBA8,
+        ktx->width >> i ? ktx->width >> i : 1, ktx->height >> i ? ktx->height >> i : 1);
+  }
+
+  uint8_t *decoded = malloc(size), *level = decoded;
+  for(uint32_t i = 0; i < ktx->levels_count; i++) {
+    const uint32_t width  = ktx->width  >> i ? ktx->width  >> i : 1;
+    const uint32_t height = ktx->height >> i ? ktx->height >> i : 1;
+    lgl_ktx_decode(ktx->format, width, height, ktx->levels[i], level);
+    ktx->levels[i]      = level;
+    ktx->level_sizes[i] = lgl_ktx_size(LGL_KTX_RGBA8, width, height);
+    level += ktx->level_sizes[i];
+  }
+  ktx->format = LGL_KTX_RGBA8;
+
+  free(data);
+  return decoded;
+}
+
+/*Uploads every level of ktx as it is into the texture bound to unit 0, so
+  nothing is generated, through the pixel buffer ring when one maps*/
+static void lgl__texture_ktx_upload(const lgl_ktx_t *ktx) {
+  size_t size = 0;
+  for(uint32_t i = 0; i < ktx->levels_count; i++) {
+    size += ktx->level_sizes[i];
+  }
+
+  uint8_t *mapped = lgl_pixels_map(size);
+  for(size_t i = 0, offset = 0; mapped && i < ktx->levels_count; offset += ktx->level_sizes[i++]) {
+    memcpy(mapped + offset, ktx->levels[i], ktx->level_sizes[i]);
+  }
+  const int streamed = mapped && lgl__pixels_unpack_begin();
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,  ktx->levels_count - 1);
+
+  size_t offset = 0;
+  for(uint32_t i = 0; i < ktx->levels_count; i++) {
+    const GLsizei width  = ktx->width  >> i ? ktx->width  >> i : 1;
+    const GLsizei height = ktx->height >> i ? ktx->height >> i : 1;
+    const void   *pixels = streamed ? (const void*)(uintptr_t)offset : ktx->levels[i];
+
+    if (ktx->format == LGL_KTX_RGBA8) {
+      glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    } else {
+      glCompressedTexImage2D(GL_TEXTURE_2D, i, ktx->format, width, height, 0,
+          ktx->level_sizes[i], pixels);
+    }
+    offset += ktx->level_sizes[i];
+  }
+
+  if (streamed) {
+    lgl__pixels_unpack_end();
+  }
+}
+
+GLuint lgl_texture_alloc(const char *imageFile) {
+  debug_log("Loading texture from '%s'", imageFile);
+
+  /*create texture*/
+  GLuint texture = lgl__texture_create();
+
+  if (lgl__texture_is_ktx(imageFile)) {
+    lgl_ktx_t ktx;
+    uint8_t  *data = lgl__texture_ktx_read(imageFile, &ktx);
+    if (data) {
+      lgl__texture_ktx_upload(&ktx);
+    } else {
+      debug_error("Failed to load texture from '%s'\n", imageFile);
+    }
+    free(data);
+    lgl__bind_texture(0, 0);
+    return texture;
+  }
+
+  /*load texture data from file*/
+  int width,
+      height,
+      numChannels;
+
+  stbi_set_flip_vertically_on_load(1);
+  unsigned char *data = stbi_load(imageFile, &width, &height, &numChannels, 0);
+
+  /*error check*/
+  if (data) {
+    lgl__texture_stream(texture, width, height, numChannels, data);
+  } else {
+    debug_error("Failed to load texture from '%s'\n", imageFile);
+  }
+
+  /*cleanup*/
+  stbi_image_free(data);
+  lgl__bind_texture(0, 0);
+  return texture;
+}
+
+/*A texture waiting for its file. Jobs move from queued to decoded on a
+  worker and are uploaded and freed on the GL thread.*/
+typedef struct lgl__texture_job_t {
+  GLuint                     texture;
+  char                      *path;
+  unsigned char             *pixels;       // NULL when the file failed to load
+  uint8_t                   *ktx_data;     // instead of pixels for .ktx files
+  lgl_ktx_t                  ktx;
+  int                        width;
+  int                        height;
+  int                        channels;
+  struct lgl__texture_job_t *next;
+} lgl__texture_job_t;
+
+typedef struct {
+  lgl__texture_job_t *first;
+  lgl__texture_job_t *last;
+} lgl__texture_jobs_t;
+
+static struct {
+  pthread_t           threads[LGL_TEXTURE_THREADS];
+  int                 threads_count;
+  int                 started;
+  int                 stopping;
+  pthread_mutex_t     mutex;
+  pthread_cond_t      wake;
+  lgl__texture_jobs_t queued;
+  lgl__texture_jobs_t decoded;
+  size_t              pending;      // jobs not uploaded yet, GL thread only
+} lgl__texture_loader = {0};
+
+static inline void lgl__texture_jobs_push(lgl__texture_jobs_t *jobs, lgl__texture_job_t *job) {
+  job->next = NULL;
+  if (jobs->last) {
+    jobs->last->next = job;
+  } else {
+    jobs->first = job;
+  }
+  jobs->last = job;
+}
+
+static inline lgl__texture_job_t *lgl__texture_jobs_pop(lgl__texture_jobs_t *jobs) {
+  lgl__texture_job_t *job = jobs->first;
+  if (job) {
+    jobs->first = job->next;
+    jobs->last  = jobs->first ? jobs->last : NULL;
+  }
+  return job;
+}
+
+static void lgl__texture_job_free(lgl__texture_job_t *job) {
+  stbi_image_free(job->pixels);
+  free(job->ktx_data);
+  free(job->path);
+  free(job);
+}
+
+static void lgl__texture_decode(lgl__texture_job_t *job) {
+  if (lgl__texture_is_ktx(job->path)) {
+    job->ktx_data = lgl__texture_ktx_read(job->path, &job->ktx);
+    return;
+  }
+  job->pixels = stbi_load(job->path, &job->width, &job->height, &job->channels, 0);
+}
+
+static void *lgl__texture_worker(void *unused) {
+  (void)unused;
+  stbi_set_flip_vertically_on_load_thread(1);
+
+  pthread_mutex_lock(&lgl__texture_loader.mutex);
+  while (!lgl__texture_loader.stopping) {
+    lgl__texture_job_t *job = lgl__texture_jobs_pop(&lgl__texture_loader.queued);
+    if (job == NULL) {
+      pthread_cond_wait(&lgl__texture_loader.wake, &lgl__texture_loader.mutex);
+      continue;
+    }
+
+    // reading and decoding are the slow part, nothing is held meanwhile
+    pthread_mutex_unlock(&lgl__texture_loader.mutex);
+    lgl__texture_decode(job);
+    pthread_mutex_lock(&lgl__texture_loader.mutex);
+
+    lgl__texture_jobs_push(&lgl__texture_loader.decoded, job);
+  }
+  pthread_mutex_unlock(&lgl__texture_loader.mutex);
+  return NULL;
+}
+
+static void lgl__texture_loader_start(void) {
+  pthread_mutex_init(&lgl__texture_loader.mutex, NULL);
+  pthread_cond_init(&lgl__texture_loader.wake, NULL);
+
+  for(int i = 0; i < LGL_TEXTURE_THREADS; i++) {
+    pthread_t *thread = &lgl__texture_loader.threads[lgl__texture_loader.threads_count];
+    if (pthread_create(thread, NULL, lgl__texture_worker, NULL) == 0) {
+      lgl__texture_loader.threads_count++;
+    }
+  }
+  if (lgl__texture_loader.threads_count == 0) {
+    debug_warn("no texture loading threads could be started, textures load on the GL thread");
+  }
+  lgl__texture_loader.started = 1;
+}
+
+GLuint lgl_texture_alloc_async(const char *path) {
+  if (!lgl__texture_loader.started) {
+    lgl__texture_loader_start();
+  }
+
+  // a single grey texel stands in until the file is uploaded
+  static const unsigned char placeholder[4] = { 128, 128, 128, 255 };
+
+  const GLuint texture = lgl__texture_create();
+  lgl__texture_image(1, 1, 4, placeholder);
+  lgl__bind_texture(0, 0);
+
+  lgl__texture_job_t *job = calloc(1, sizeof(*job));
+  job->texture = texture;
+  job->path    = strdup(path);
+  lgl__texture_loader.pending++;
+
+  if (lgl__texture_loader.threads_count == 0) {
+    stbi_set_flip_vertically_on_load(1);
+    lgl__texture_decode(job);
+    pthread_mutex_lock(&lgl__texture_loader.mutex);
+    lgl__texture_jobs_push(&lgl__texture_loader.decoded, job);
+    pthread_mutex_unlock(&lgl__texture_loader.mutex);
+    return texture;
+  }
+
+  pthread_mutex_lock(&lgl__texture_loader.mutex);
+  lgl__texture_jobs_push(&lgl__texture_loader.queued, job);
+  pthread_cond_signal(&lgl__texture_loader.wake);
+  pthread_mutex_unlock(&lgl__texture_loader.mutex);
+  return texture;
+}
+
+static inline double lgl__seconds(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+size_t lgl_texture_uploads_process(const float budget) {
+  if (!lgl__texture_loader.started) {
+    return 0;
+  }
+
+  const double start = lgl__seconds();
+  do {
+    pthread_mutex_lock(&lgl__texture_loader.mutex);
+    lgl__texture_job_t *job = lgl__texture_jobs_pop(&lgl__texture_loader.decoded);
+    pthread_mutex_unlock(&lgl__texture_loader.mutex);
+    if (job == NULL) {
+      break;
+    }
+
+    if (job->ktx_data) {
+      lgl__bind_texture(0, job->texture);
+      lgl__texture_ktx_upload(&job->ktx);
+      lgl__bind_texture(0, 0);
+    } else if (job->pixels) {
+      lgl__texture_stream(job->texture, job->width, job->height, job->channels, job->pixels);
+    } else {
+      debug_error("Failed to load texture from '%s'", job->path);
+    }
+
+    lgl__texture_job_free(job);
+    lgl__texture_loader.pending--;
+  } while (lgl__seconds() - start < budget);
+
+  return lgl__texture_loader.pending;
+}
+
+void lgl_texture_loader_free(void) {
+  if (!lgl__texture_loader.started) {
+    return;
+  }
+
+  pthread_mutex_lock(&lgl__texture_loader.mutex);
+  lgl__texture_loader.stopping = 1;
+  pthread_cond_broadcast(&lgl__texture_loader.wake);
+  pthread_mutex_unlock(&lgl__texture_loader.mutex);
+
+  for(int i = 0; i < lgl__texture_loader.threads_count; i++) {
+    pthread_join(lgl__texture_loader.threads[i], NULL);
+  }
+
+  // textures whose files never arrived keep their placeholder
+  lgl__texture_job_t *job;
+  while ((job = lgl__texture_jobs_pop(&lgl__texture_loader.queued))) {
+    lgl__texture_job_free(job);
+  }
+  while ((job = lgl__texture_jobs_pop(&lgl__texture_loader.decoded))) {
+    lgl__texture_job_free(job);
+  }
+
+  pthread_mutex_destroy(&lgl__texture_loader.mutex);
+  pthread_cond_destroy(&lgl__texture_loader.wake);
+  lgl__texture_loader.threads_count = 0;
+  lgl__texture_loader.started       = 0;
+  lgl__texture_loader.stopping      = 0;
+  lgl__texture_loader.pending       = 0;
+}
+
+GLuint lgl_shader_compile(const char *file_path, GLenum type) {
+  debug_log("compiling shader from '%s'", file_path);
+  file_buffer fb = file_buffer_alloc(file_path);
+  if (fb.error) { // error check
+    debug_error("failed to read shader from '%s'\n", file_path);
+  }
+
+  const char* shader_source = fb.text;
+
+  GLuint shader = glCreateShader(type);
+  glShaderSource   (shader, 1, &shader_source, NULL);
+  glCompileShader  (shader);
+
+  file_buffer_free(fb);
+
+  { // error check
+    int  success;
+    char  infoLog[512];
+
+    glGetShaderiv  (shader, GL_COMPILE_STATUS, &success);
+
+    if(!success) {
+      glGetShaderInfoLog(shader, 512, NULL, infoLog);
+      debug_error("Error shader compilation failed:\n%s", infoLog);
+    }
+  }
+
+  return shader;
+}
+
+GLuint lgl_shader_link (GLuint vertex_shader, GLuint fragment_shader) {
+  GLuint shader = glCreateProgram();
+  glAttachShader  (shader, vertex_shader);
+  glAttachShader  (shader, fragment_shader);
+  glLinkProgram   (shader);
+  glDetachShader  (shader, vertex_shader);
+  glDetachShader  (shader, fragment_shader);
+  glDeleteShader  (vertex_shader);
+  glDeleteShader  (fragment_shader);
+  lgl__uniforms_get(shader);
+  return shader;
+}
+
+/*Sets up lgl_vertex_t attributes for the bound VAO, read from the bound
+  GL_ARRAY_BUFFER*/
+static void lgl__vertex_attributes_set(void) {
+  glVertexAttribPointer(
+      0, 3, GL_FLOAT, GL_FALSE, sizeof(lgl_vertex_t),
+      (void*)offsetof(lgl_vertex_t, position));
+
+  glVertexAttribPointer(
+      1, 3, GL_FLOAT, GL_FALSE, sizeof(lgl_vertex_t),
+      (void*)offsetof(lgl_vertex_t, normal));
+
+  glVertexAttribPointer(
+      2, 2, GL_FLOAT, GL_FALSE, sizeof(lgl_vertex_t),
+      (void*)offsetof(lgl_vertex_t, texture_coordinates));
+
+  glEnableVertexAttribArray(0);
+  glEnableVertexAttribArray(1);
+  glEnableVertexAttribArray(2);
+}
+
+static void lgl__vertex_attributes_set_packed(void) {
+  glVertexAttribPointer(
+      0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(lgl_vertex_packed_t),
+      (void*)offsetof(lgl_vertex_packed_t, position));
+
+  glVertexAttribPointer(
+      1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(lgl_vertex_packed_t),
+      (void*)offsetof(lgl_vertex_packed_t, normal));
+
+  glVertexAttribPointer(
+      2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(lgl_vertex_packed_t),
+      (void*)offsetof(lgl_vertex_packed_t, texture_coordinates));
+
+  glEnableVertexAttribArray(0);
+  glEnableVertexAttribArray(1);
+  glEnableVertexAttribArray(2);
+}
+
+/*The offset and scale that turn packed positions back into object space.
+  Float positions get the identity.*/
+static inline void lgl__position_dequantization(
+    const lgl_render_data_t *data,
+    lgl_3f_t                *offset,
+    lgl_3f_t                *scale) {
+  if (data->vertex_format != LGL_VERTEX_FORMAT_PACKED) {
+    *offset = lgl_3f_zero();
+    *scale  = lgl_3f_one(1.0);
+    return;
+  }
+
+  const lgl_3f_t min = data->bounds.min, max = data->bounds.max;
+  *offset = min;
+  *scale  = (lgl_3f_t) { max.x - min.x, max.y - min.y, max.z - min.z };
+}
+
+/*Sets u_position_offset and u_position_scale, see
+  lgl__position_dequantization*/
+static inline void lgl__position_dequantize(
+    const lgl__uniforms_t   *uniforms,
+    const lgl_render_data_t *data) {
+  lgl_3f_t offset, scale;
+  lgl__position_dequantization(data, &offset, &scale);
+  glUniform3f(uniforms->position_offset, offset.x, offset.y, offset.z);
+  glUniform3f(uniforms->position_scale,  scale.x,  scale.y,  scale.z);
+}
+
+/*The largest factor a model matrix scales any direction by*/
+static inline float lgl__model_scale_max(const GLfloat *m) {
+  const float
+    x = m[0] * m[0] + m[1] * m[1] + m[ 2] * m[ 2],
+    y = m[4] * m[4] + m[5] * m[5] + m[ 6] * m[ 6],
+    z = m[8] * m[8] + m[9] * m[9] + m[10] * m[10];
+  return sqrtf(fmaxf(x, fmaxf(y, z)));
+}
+
+lgl_bounds_t lgl_bounds_transform(const lgl_bounds_t *bounds, const GLfloat *m) {
+  lgl_bounds_t result = {0};
+
+  const lgl_4f_t center = lgl_mat4_transform(m,
+      (lgl_4f_t) { bounds->center.x, bounds->center.y, bounds->center.z, 1.0 });
+  result.center = (lgl_3f_t) { center.x, center.y, center.z };
+  result.radius = bounds->radius * lgl__model_scale_max(m);
+
+  // Arvo's method, the box center is transformed and the half extents are
+  // projected onto each axis through the absolute rotation and scale
+  const lgl_3f_t
+    box_center = {
+      (bounds->min.x + bounds->max.x) * 0.5f,
+      (bounds->min.y + bounds->max.y) * 0.5f,
+      (bounds->min.z + bounds->max.z) * 0.5f,
+    },
+    extent = {
+      (bounds->max.x - bounds->min.x) * 0.5f,
+      (bounds->max.y - bounds->min.y) * 0.5f,
+      (bounds->max.z - bounds->min.z) * 0.5f,
+    };
+
+  const lgl_4f_t c = lgl_mat4_transform(m,
+      (lgl_4f_t) { box_center.x, box_center.y, box_center.z, 1.0 });
+
+  const lgl_3f_t e = {
+    fabsf(m[0]) * extent.x + fabsf(m[4]) * extent.y + fabsf(m[ 8]) * extent.z,
+    fabsf(m[1]) * extent.x + fabsf(m[5]) * extent.y + fabsf(m[ 9]) * extent.z,
+    fabsf(m[2]) * extent.x + fabsf(m[6]) * extent.y + fabsf(m[10]) * extent.z,
+  };
+
+  result.min = (lgl_3f_t) { c.x - e.x, c.y - e.y, c.z - e.z };
+  result.max = (lgl_3f_t) { c.x + e.x, c.y + e.y, c.z + e.z };
+
+  return result;
+}
+
+/*Uploads vertices into a new VAO and VBO. bounds receives their bounds and
+  may be NULL.*/
+void lgl__buffer_vertex_array (
+    GLuint             *VAO,
+    GLuint             *VBO,
+    lgl_bounds_t       *bounds,
+    GLuint              vertex_count,
+    const lgl_vertex_t *vertices) {
+  if (bounds) {
+    *bounds = lgl_bounds_compute(vertex_count, vertices);
+  }
+
+  glGenVertexArrays(1, VAO);
+  lgl__bind_vertex_array(*VAO);
+
+  glGenBuffers(1, VBO);
+  glBindBuffer(GL_ARRAY_BUFFER, *VBO);
+
+  glBufferData(GL_ARRAY_BUFFER, 
+      vertex_count*sizeof(lgl_vertex_t), 
+      vertices, 
+      GL_STATIC_DRAW);
+
+  lgl__vertex_attributes_set();
+}
+
+/*Uploads indices into a new EBO attached to the bound VAO*/
+static void lgl__buffer_element_array(
+    GLuint         *EBO,
+    const size_t    index_count,
+    const uint32_t *indices) {
+  glGenBuffers(1, EBO);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *EBO);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+      index_count * sizeof(*indices),
+      indices,
+      GL_STATIC_DRAW);
+}
+
+/*Uploads vertices already in vertex_format and indices into data's VAO, VBO
+  and EBO. Packed vertices must be relative to data's bounds. Without indices
+  there is no EBO and the vertices are drawn as a triangle list.*/
+static void lgl__buffer_mesh_raw(
+    lgl_render_data_t  *data,
+    const size_t        vertex_count,
+    const void         *vertices,
+    const size_t        index_count,
+    const uint32_t     *indices,
+    const GLint         vertex_format) {
+  const size_t vertex_size = vertex_format == LGL_VERTEX_FORMAT_PACKED ?
+    sizeof(lgl_vertex_packed_t) : sizeof(lgl_vertex_t);
+
+  glGenVertexArrays(1, &data->VAO);
+  lgl__bind_vertex_array(data->VAO);
+
+  glGenBuffers(1, &data->VBO);
+  glBindBuffer(GL_ARRAY_BUFFER, data->VBO);
+  glBufferData(GL_ARRAY_BUFFER, vertex_count * vertex_size, vertices, GL_STATIC_DRAW);
+
+  if (vertex_format == LGL_VERTEX_FORMAT_PACKED) {
+    lgl__vertex_attributes_set_packed();
+  } else {
+    lgl__vertex_attributes_set();
+  }
+  if (index_count) {
+    lgl__buffer_element_array(&data->EBO, index_count, indices);
+  }
+
+  data->vertex_format = vertex_format;
+  data->vertex_count  = vertex_count;
+  data->index_count   = index_count;
+}
+
+/*Uploads vertices and indices as they are, converting the vertices to
+  vertex_format, see lgl__buffer_mesh_raw*/
+static void lgl__buffer_mesh_indexed(
+    lgl_render_data_t  *data,
+    const size_t        vertex_count,
+    const lgl_vertex_t *vertices,
+    const size_t        index_count,
+    const uint32_t     *indices,
+    const GLint         vertex_format) {
+  data->bounds = lgl_bounds_compute(vertex_count, vertices);
+
+  if (vertex_format == LGL_VERTEX_FORMAT_PACKED) {
+    lgl_vertex_packed_t *packed = malloc(vertex_count * sizeof(*packed));
+    lgl_mesh_quantize(vertex_count, vertices, &data->bounds, packed);
+    lgl__buffer_mesh_raw(data, vertex_count, packed, index_count, indices, vertex_format);
+    free(packed);
+  } else {
+    lgl__buffer_mesh_raw(data, vertex_count, vertices, index_count, indices, vertex_format);
+  }
+}
+
+/*Welds vertices that have no indices yet, reorders the triangles for the
+  vertex cache and uploads both, see lgl__buffer_mesh_indexed*/
+static void lgl__buffer_mesh(
+    lgl_render_data_t  *data,
+    const size_t        vertex_count,
+    const lgl_vertex_t *vertices,
+    const size_t        index_count,
+    const uint32_t     *indices,
+    const GLint         vertex_format) {
+
+  lgl_vertex_t *unique       = NULL;
+  uint32_t     *optimized    = NULL;
+  size_t        unique_count = vertex_count;
+  size_t        count        = index_count;
+
+  if (indices == NULL) {
+    unique       = malloc(vertex_count * sizeof(*unique));
+    optimized    = malloc(vertex_count * sizeof(*optimized));
+    unique_count = lgl_mesh_weld(vertex_count, vertices, unique, optimized);
+    count        = vertex_count;
+  } else {
+    optimized = malloc(index_count * sizeof(*optimized));
+    memcpy(optimized, indices, index_count * sizeof(*optimized));
+  }
+
+  lgl_mesh_optimize_cache(count, optimized, unique_count);
+
+  lgl__buffer_mesh_indexed(data, unique_count, unique ? unique : vertices,
+      count, optimized, vertex_format);
+
+  free(unique);
+  free(optimized);
+}
+
+/*Meshes are reference counted entries of one array, a handle is the index
+  plus one. Entries of released meshes are reused by later uploads.*/
+typedef struct {
+  GLuint         VAO;
+  GLuint         VBO;
+  GLuint         EBO;
+  size_t         vertex_count;
+  size_t         index_count;
+  GLint          vertex_format;
+  lgl_bounds_t   bounds;
+  lgl_lods_t     lods;
+  uint32_t       references;
+  char          *name;
+} lgl__mesh_t;
+
+static struct {
+  lgl__mesh_t   *entries;
+  size_t         count;
+  size_t         capacity;
+} lgl__meshes = {0};
+
+static inline lgl__mesh_t *lgl__mesh_get(lgl_mesh_t mesh) {
+  if (mesh == LGL_MESH_NONE || mesh > lgl__meshes.count ||
+      lgl__meshes.entries[mesh - 1].references == 0) {
+    debug_error("mesh %u does not exist", mesh);
+    return NULL;
+  }
+  return &lgl__meshes.entries[mesh - 1];
+}
+
+/*Takes over the buffers an upload left in data, with one reference*/
+static lgl_mesh_t lgl__mesh_register(const char *name, const lgl_render_data_t *data) {
+  size_t i = 0;
+  while (i < lgl__meshes.count && lgl__meshes.entries[i].references) {
+    i++;
+  }
+  if (i == lgl__meshes.count) {
+    lgl__reserve((void**)&lgl__meshes.entries, &lgl__meshes.capacity,
+        lgl__meshes.count + 1, sizeof(*lgl__meshes.entries));
+    lgl__meshes.count++;
+  }
+
+  lgl__meshes.entries[i] = (lgl__mesh_t) {
+    .VAO           = data->VAO,
+    .VBO           = data->VBO,
+    .EBO           = data->EBO,
+    .vertex_count  = data->vertex_count,
+    .index_count   = data->index_count,
+    .vertex_format = data->vertex_format,
+    .bounds        = data->bounds,
+    .lods          = data->lods,
+    .references    = 1,
+    .name          = name ? strdup(name) : NULL,
+  };
+  return i + 1;
+}
+
+lgl_mesh_t lgl_mesh_upload(
+    const char         *name,
+    const size_t        vertex_count,
+    const lgl_vertex_t *vertices,
+    const size_t        index_count,
+    const uint32_t     *indices,
+    const GLint         vertex_format) {
+  lgl_render_data_t uploaded = {0};
+  lgl__buffer_mesh(&uploaded, vertex_count, vertices, index_count, indices, vertex_format);
+  return lgl__mesh_register(name, &uploaded);
+}
+
+void lgl_mesh_acquire(lgl_mesh_t mesh) {
+  lgl__mesh_t *entry = lgl__mesh_get(mesh);
+  if (entry) {
+    entry->references++;
+  }
+}
+
+void lgl_mesh_release(lgl_mesh_t mesh) {
+  lgl__mesh_t *entry = lgl__mesh_get(mesh);
+  if (entry == NULL || --entry->references > 0) {
+    return;
+  }
+
+  glDeleteVertexArrays(1, &entry->VAO);
+  glDeleteBuffers(1, &entry->VBO);
+  if (entry->EBO) {
+    glDeleteBuffers(1, &entry->EBO);
+  }
+  lgl_state_invalidate();
+
+  free(entry->name);
+  *entry = (lgl__mesh_t){0};
+}
+
+lgl_mesh_t lgl_mesh_find(const char *name) {
+  for(size_t i = 0; i < lgl__meshes.count; i++) {
+    const lgl__mesh_t *entry = &lgl__meshes.entries[i];
+    if (entry->references && entry->name && strcmp(entry->name, name) == 0) {
+      return i + 1;
+    }
+  }
+  return LGL_MESH_NONE;
+}
+
+lgl_render_data_t lgl_mesh_instance(lgl_mesh_t mesh) {
+  lgl_render_data_t data = {0};
+
+  const lgl__mesh_t *entry = lgl__mesh_get(mesh);
+  if (entry == NULL) {
+    return data;
+  }
+  lgl_mesh_acquire(mesh);
+
+  data.mesh           = mesh;
+  data.VAO            = entry->VAO;
+  data.VBO            = entry->VBO;
+  data.EBO            = entry->EBO;
+  data.vertex_count   = entry->vertex_count;
+  data.index_count    = entry->index_count;
+  data.vertex_format  = entry->vertex_format;
+  data.bounds         = entry->bounds;
+  data.lods           = entry->lods;
+
+  data.transform      = lgl_transform_alloc();
+
+  data.texture_offset = lgl_2f_zero();
+  data.texture_scale  = lgl_2f_one(1.0);
+
+  data.render_flags   = LGL_FLAG_ENABLED;
+  return data;
+}
+
+void lgl_render_data_free(lgl_render_data_t *data) {
+  if (data->mesh != LGL_MESH_NONE) {
+    lgl_mesh_release(data->mesh);
+  }
+  if (data->transform != LGL_TRANSFORM_NONE) {
+    lgl_transform_free(data->transform);
+  }
+  *data = (lgl_render_data_t){0};
+}
+
+lgl_render_data_t lgl_render_data_copy(const lgl_render_data_t *data) {
+  lgl_render_data_t copy = *data;
+
+  if (data->mesh != LGL_MESH_NONE) {
+    lgl_mesh_acquire(data->mesh);
+  }
+  if (data->transform != LGL_TRANSFORM_NONE) {
+    copy.transform = lgl_transform_alloc();
+    lgl_transform_position_set(copy.transform, lgl_transform_position(data->transform));
+    lgl_transform_rotation_set(copy.transform, lgl_transform_rotation(data->transform));
+    lgl_transform_scale_set   (copy.transform, lgl_transform_scale   (data->transform));
+    lgl_transform_parent_set  (copy.transform, lgl_transform_parent  (data->transform));
+  }
+  return copy;
+}
+
+/*Sets the polygon mode and stencil mask an object's render flags ask for*/
+static inline void lgl__render_flags_apply(GLint render_flags) {
+  if (render_flags & LGL_FLAG_USE_WIREFRAME) {
+    lgl__polygon_mode(GL_LINE);
+  } else {
+    lgl__polygon_mode(GL_FILL);
+  }
+
+  if (render_flags & LGL_FLAG_USE_STENCIL) {
+    lgl__stencil_mask(0xFF);
+  } else {
+    lgl__stencil_mask(0x00);
+  }
+}
+
+/*World transform of an object as the instanced and indirect paths stream
+  it. The normal matrix is stored as three vec4 columns, the std140/std430
+  layout of a mat3.*/
+typedef struct {
+  GLfloat        model[16];
+  GLfloat        normal[12];
+} lgl__transform_t;
+
+static inline void lgl__transform_copy(lgl__transform_t *transform, const lgl_render_data_t *data) {
+  memcpy(transform->model,  lgl__transform_model (data->transform), sizeof(transform->model));
+  memcpy(transform->normal, lgl__transform_normal(data->transform), sizeof(transform->normal));
+}
+
+/*World space bounding sphere, center in xyz and radius in w. Unknown bounds
+  get an infinite radius, so they are never outside anything.*/
+static inline lgl_4f_t lgl__world_sphere(const lgl_render_data_t *data) {
+  const lgl_bounds_t *bounds = &data->bounds;
+  if (bounds->radius <= 0) {
+    return (lgl_4f_t) { 0, 0, 0, INFINITY };
+  }
+
+  const GLfloat *m = lgl__transform_model(data->transform);
+  const lgl_3f_t c = bounds->center;
+  return (lgl_4f_t) {
+    m[0] * c.x + m[4] * c.y + m[ 8] * c.z + m[12],
+    m[1] * c.x + m[5] * c.y + m[ 9] * c.z + m[13],
+    m[2] * c.x + m[6] * c.y + m[10] * c.z + m[14],
+    bounds->radius * lgl__model_scale_max(m),
+  };
+}
+
+/*Occlusion culling reads back the depth of earlier frames through a ring of
+  pixel pack buffers, so the CPU never waits on the GPU for it. Each finished
+  readback becomes the base of a max-depth pyramid, and objects are tested
+  against the pyramid with the view-projection the depth was drawn with.*/
+static struct {
+  GLuint    buffers[LGL_OCCLUSION_FRAMES];
+  GLsync    fences[LGL_OCCLUSION_FRAMES];
+  GLfloat   view_projections[LGL_OCCLUSION_FRAMES][16];
+  int       widths[LGL_OCCLUSION_FRAMES];
+  int       heights[LGL_OCCLUSION_FRAMES];
+  size_t    oldest;                 // oldest readback in flight
+  size_t    pending;                // readbacks in flight
+
+  GLfloat   view_projection[16];    // of the depth in levels
+  float    *levels[LGL_OCCLUSION_LEVELS];
+  int       level_widths[LGL_OCCLUSION_LEVELS];
+  int       level_heights[LGL_OCCLUSION_LEVELS];
+  size_t    levels_count;           // 0 until a readback finishes
+  float    *pyramid;
+  size_t    pyramid_capacity;
+} lgl__occlusion = {0};
+
+/*Builds the pyramid from a finished readback. Each level keeps the farthest
+  depth of the 2x2 texels below it, so a texel is never nearer than anything
+  it covers.*/
+static void lgl__occlusion_build(const float *depth, const int width, const int height) {
+  size_t size = 0;
+  for(int w = width, h = height, i = 0; i < LGL_OCCLUSION_LEVELS; i++) {
+    size += (size_t)w * h;
+    if (w == 1 && h == 1) { break; }
+    w = (w + 1) / 2;
+    h = (h + 1) / 2;
+  }
+  lgl__reserve((void**)&lgl__occlusion.pyramid, &lgl__occlusion.pyramid_capacity,
+      size, sizeof(*lgl__occlusion.pyramid));
+
+  float *level = lgl__occlusion.pyramid;
+  memcpy(level, depth, (size_t)width * height * sizeof(*level));
+
+  lgl__occlusion.levels[0]        = level;
+  lgl__occlusion.level_widths[0]  = width;
+  lgl__occlusion.level_heights[0] = height;
+
+  size_t i = 1;
+  for(; i < LGL_OCCLUSION_LEVELS; i++) {
+    const float *below = lgl__occlusion.levels[i - 1];
+    const int    bw    = lgl__occlusion.level_widths[i - 1];
+    const int    bh    = lgl__occlusion.level_heights[i - 1];
+    if (bw == 1 && bh == 1) {
+      break;
+    }
+
+    const int w = (bw + 1) / 2, h = (bh + 1) / 2;
+    level += (size_t)bw * bh;
+
+    for(int y = 0; y < h; y++) {
+      const float *row0 = &below[(size_t)(2 * y) * bw];
+      const float *row1 = &below[(size_t)(2 * y + 1 < bh ? 2 * y + 1 : 2 * y) * bw];
+      for(int x = 0; x < w; x++) {
+        const int x0 = 2 * x, x1 = 2 * x + 1 < bw ? 2 * x + 1 : 2 * x;
+        level[(size_t)y * w + x] = fmaxf(fmaxf(row0[x0], row0[x1]), fmaxf(row1[x0], row1[x1]));
+      }
+    }
+
+    lgl__occlusion.levels[i]        = level;
+    lgl__occlusion.level_widths[i]  = w;
+    lgl__occlusion.level_heights[i] = h;
+  }
+  lgl__occlusion.levels_count = i;
+}
+
+/*Consumes the readbacks the GPU has finished, oldest first, without
+  waiting. The newest finished one ends up in the pyramid.*/
+static void lgl__occlusion_poll(void) {
+  while (lgl__occlusion.pending > 0) {
+    const size_t slot  = lgl__occlusion.oldest;
+    GLsync       fence = lgl__occlusion.fences[slot];
+
+    if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+      return;
+    }
+    glDeleteSync(fence);
+    lgl__occlusion.fences[slot] = NULL;
+
+    const int width = lgl__occlusion.widths[slot], height = lgl__occlusion.heights[slot];
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, lgl__occlusion.buffers[slot]);
+    const float *depth = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+        (size_t)width * height * sizeof(float), GL_MAP_READ_BIT);
+    if (depth) {
+      lgl__occlusion_build(depth, width, height);
+      memcpy(lgl__occlusion.view_projection, lgl__occlusion.view_projections[slot],
+          sizeof(lgl__occlusion.view_projection));
+      glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    lgl__occlusion.oldest = (slot + 1) % LGL_OCCLUSION_FRAMES;
+    lgl__occlusion.pending--;
+  }
+}
+
+void lgl_occlusion_capture(const lgl_frame_t *frame) {
+  lgl__occlusion_poll();
+
+  if (!lgl__camera_active || lgl__occlusion.pending == LGL_OCCLUSION_FRAMES) {
+    return; // every buffer is still in flight, skip this frame rather than wait
+  }
+
+  const size_t slot   = (lgl__occlusion.oldest + lgl__occlusion.pending) % LGL_OCCLUSION_FRAMES;
+  const int    width  = frame->width;
+  const int    height = frame->height;
+  const size_t size   = (size_t)width * height * sizeof(float);
+
+  if (lgl__occlusion.buffers[slot] == 0) {
+    glGenBuffers(1, &lgl__occlusion.buffers[slot]);
+  }
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, lgl__occlusion.buffers[slot]);
+  if (lgl__occlusion.widths[slot] != width || lgl__occlusion.heights[slot] != height) {
+    glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+    lgl__occlusion.widths[slot]  = width;
+    lgl__occlusion.heights[slot] = height;
+  }
+
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, frame->frame_buffer);
+  glReadPixels(0, 0, width, height, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  memcpy(lgl__occlusion.view_projections[slot], lgl__camera.view_projection,
+      sizeof(lgl__occlusion.view_projections[slot]));
+  lgl__occlusion.fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  lgl__occlusion.pending++;
+}
+
+void lgl_occlusion_clear(void) {
+  lgl__occlusion.levels_count = 0;
+}
+
+/*Returns 1 when the world space box is behind the depth in the pyramid.
+  Boxes that reach behind the depth's camera are never occluded.*/
+static int lgl__occluded(const lgl_3f_t min, const lgl_3f_t max) {
+  const GLfloat *vp = lgl__occlusion.view_projection;
+
+  float u_min = 1, v_min = 1, u_max = 0, v_max = 0, nearest = 1;
+  for(int i = 0; i < 8; i++) {
+    const float
+      x = i & 1 ? max.x : min.x,
+      y = i & 2 ? max.y : min.y,
+      z = i & 4 ? max.z : min.z;
+
+    const float w = vp[3] * x + vp[7] * y + vp[11] * z + vp[15];
+    if (w <= 1e-5f) {
+      return 0;
+    }
+
+    const float
+      u = ((vp[0] * x + vp[4] * y + vp[ 8] * z + vp[12]) / w) * 0.5f + 0.5f,
+      v = ((vp[1] * x + vp[5] * y + vp[ 9] * z + vp[13]) / w) * 0.5f + 0.5f,
+      d = ((vp[2] * x + vp[6] * y + vp[10] * z + vp[14]) / w) * 0.5f + 0.5f;
+
+    u_min = fminf(u_min, u); u_max = fmaxf(u_max, u);
+    v_min = fminf(v_min, v); v_max = fmaxf(v_max, v);
+    nearest = fminf(nearest, d);
+  }
+
+  // outside the screen, the frustum test decides
+  if (u_max < 0 || v_max < 0 || u_min > 1 || v_min > 1) {
+    return 0;
+  }
+
+  const int width = lgl__occlusion.level_widths[0], height = lgl__occlusion.level_heights[0];
+  const int
+    x0 = fminf(fmaxf(u_min, 0) * width,  width  - 1), x1 = fminf(fminf(u_max, 1) * width,  width  - 1),
+    y0 = fminf(fmaxf(v_min, 0) * height, height - 1), y1 = fminf(fminf(v_max, 1) * height, height - 1);
+
+  // the finest level where the rectangle covers at most 4x4 texels
+  size_t level = 0;
+  while (level + 1 < lgl__occlusion.levels_count &&
+      ((x1 >> level) - (x0 >> level) >= 4 || (y1 >> level) - (y0 >> level) >= 4)) {
+    level++;
+  }
+
+  const float *depth = lgl__occlusion.levels[level];
+  const int    w     = lgl__occlusion.level_widths[level];
+  for(int y = y0 >> level; y <= y1 >> level; y++) {
+    for(int x = x0 >> level; x <= x1 >> level; x++) {
+      if (nearest <= depth[(size_t)y * w + x]) {
+        return 0;
+      }
+    }
+  }
+  return 1;
+}
+
+static int lgl__object_occluded(const lgl_render_data_t *data) {
+  if (lgl__occlusion.levels_count == 0 || data->bounds.radius <= 0) {
+    return 0;
+  }
+
+  const lgl_bounds_t world = lgl_bounds_transform(&data->bounds, lgl__transform_model(data->transform));
+  return lgl__occluded(world.min, world.max);
+}
+
+/*Scratch for lgl__cull, reused between calls*/
+static struct {
+  lgl_4f_t *spheres;
+  size_t    spheres_capacity;
+  uint8_t  *visible;
+  size_t    visible_capacity;
+} lgl__culling = {0};
+
+/*Tests every object against the active camera's frustum in one batch and
+  returns one visibility byte per object. Transforms must be up to date.*/
+static const uint8_t *lgl__cull(const size_t count, const lgl_render_data_t *data) {
+  lgl__reserve((void**)&lgl__culling.spheres, &lgl__culling.spheres_capacity,
+      count, sizeof(*lgl__culling.spheres));
+  lgl__reserve((void**)&lgl__culling.visible, &lgl__culling.visible_capacity,
+      count, sizeof(*lgl__culling.visible));
+
+  uint8_t *visible = lgl__culling.visible;
+  if (!lgl__camera_active) {
+    memset(visible, 1, count);
+    return visible;
+  }
+
+  lgl_4f_t *spheres = lgl__culling.spheres;
+  for(size_t i = 0; i < count; i++) {
+    spheres[i] = lgl__world_sphere(&data[i]);
+  }
+
+  lgl_frustum_test_spheres(count, visible, lgl__camera.frustum, spheres);
+
+  for(size_t i = 0; i < count; i++) {
+    if ((data[i].render_flags & LGL_FLAG_ENABLED) == 0) {
+      continue;
+    }
+
+    if (!visible[i]) {
+      lgl__stats.objects_culled++;
+    } else if (lgl__object_occluded(&data[i])) {
+      visible[i] = 0;
+      lgl__stats.objects_occluded++;
+    } else {
+      lgl__stats.objects_visible++;
+    }
+  }
+
+  return visible;
+}
+
+/*Draws count indices from first, or count vertices for objects without an
+  EBO. The object's VAO must be bound.*/
+static inline void lgl__draw_range(
+    const lgl_render_data_t *data,
+    const size_t             first,
+    const size_t             count) {
+  if (data->EBO) {
+    glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, (void*)(first * sizeof(uint32_t)));
+  } else {
+    glDrawArrays(GL_TRIANGLES, first, count);
+  }
+  lgl__stats.draw_calls++;
+}
+
+/*Draws a single enabled object*/
+static void lgl__draw_object(
+    const lgl_render_data_t *data,
+    const GLfloat           *model,
+    const GLfloat           *n) {
+  const lgl__uniforms_t *uniforms = lgl__uniforms_get(data->shader);
+
+  lgl__use_program(data->shader);
+  lgl__render_flags_apply(data->render_flags);
+
+  const GLfloat normal[9] = {
+    n[0], n[1], n[ 2],
+    n[4], n[5], n[ 6],
+    n[8], n[9], n[10],
+  };
+  glUniformMatrix4fv(uniforms->model,         1, GL_FALSE, model);
+  glUniformMatrix3fv(uniforms->normal_matrix, 1, GL_FALSE, normal);
+
+  // textures
+  lgl__bind_texture(0, data->diffuse_map);
+  lgl__bind_texture(1, data->specular_map);
+
+  glUniform2f(uniforms->texture_offset,
+      data->texture_offset.x,
+      data->texture_offset.y);
+
+  glUniform2f(uniforms->texture_scale,
+      data->texture_scale.x,
+      data->texture_scale.y);
+
+  lgl__position_dequantize(uniforms, data);
+
+  lgl__bind_vertex_array(data->VAO);
+
+  const lgl_lods_t *lods = &data->lods;
+  if (lods->count == 0) {
+    glUniform1f(uniforms->lod_fade, 0);
+    lgl__draw_range(data, 0, data->EBO ? data->index_count : data->vertex_count);
+    return;
+  }
+
+  // while fading, both levels are drawn with complementary dither patterns.
+  // a fade of 0 reads as no fade in the shader, so on the frame a fade
+  // starts only the previous level is drawn, whole
+  float fade = 0;
+  if (lods->fade < 1) {
+    const lgl_lod_t *previous = &lods->levels[lods->previous];
+    glUniform1f(uniforms->lod_fade, -lods->fade);
+    lgl__draw_range(data, previous->first, previous->count);
+    if (lods->fade <= 0) {
+      return;
+    }
+    fade = lods->fade;
+  }
+
+  const lgl_lod_t *current = &lods->levels[lods->current];
+  glUniform1f(uniforms->lod_fade, fade);
+  lgl__draw_range(data, current->first, current->count);
+}
+
+
+void lgl_lods_buffer(
+    lgl_render_data_t   *data,
+    const size_t         levels_count,
+    lgl_vertex_t *const *vertices,
+    const size_t        *vertex_counts,
+    const float         *screen_sizes) {
+
+  if (levels_count == 0 || levels_count > LGL_LOD_MAX) {
+    debug_error("an object takes 1 to %d levels of detail, got %lu", LGL_LOD_MAX, levels_count);
+    return;
+  }
+
+  size_t vertex_count = 0;
+  for(size_t i = 0; i < levels_count; i++) {
+    vertex_count += vertex_counts[i];
+  }
+
+  lgl_vertex_t *packed = malloc(vertex_count * sizeof(*packed));
+
+  data->lods = (lgl_lods_t) { .count = levels_count, .fade = 1 };
+  for(size_t i = 0, first = 0; i < levels_count; i++) {
+    memcpy(&packed[first], vertices[i], vertex_counts[i] * sizeof(*packed));
+    data->lods.levels[i] = (lgl_lod_t) {
+      .first       = first,
+      .count       = vertex_counts[i],
+      .screen_size = screen_sizes[i],
+    };
+    first += vertex_counts[i];
+  }
+
+  lgl_render_data_t uploaded = { .lods = data->lods };
+  lgl__buffer_vertex_array(&uploaded.VAO, &uploaded.VBO, &uploaded.bounds, vertex_count, packed);
+  uploaded.vertex_count = vertex_count;
+  free(packed);
+
+  // the object lets go of its old mesh and holds the only reference to this one
+  if (data->mesh != LGL_MESH_NONE) {
+    lgl_mesh_release(data->mesh);
+  }
+  data->mesh          = lgl__mesh_register(NULL, &uploaded);
+  data->VAO           = uploaded.VAO;
+  data->VBO           = uploaded.VBO;
+  data->EBO           = 0;
+  data->vertex_count  = vertex_count;
+  data->index_count   = 0;
+  data->vertex_format = LGL_VERTEX_FORMAT_FLOAT;
+  data->bounds        = uploaded.bounds;
+}
+
+/*Steps from the current level towards the one size asks for. A level is
+  left only once size is past its threshold by LGL_LOD_HYSTERESIS, so
+  objects sitting on a threshold do not flicker between levels.*/
+static inline uint8_t lgl__lod_level(const lgl_lods_t *lods, const float size) {
+  uint8_t level = lods->current;
+  while (level > 0 &&
+      size >= lods->levels[level - 1].screen_size * (1 + LGL_LOD_HYSTERESIS)) {
+    level--;
+  }
+  while (level + 1 < lods->count &&
+      size < lods->levels[level].screen_size * (1 - LGL_LOD_HYSTERESIS)) {
+    level++;
+  }
+  return level;
+}
+
+void lgl_lod_select(
+    const size_t       data_length,
+    lgl_render_data_t *data,
+    const float        delta_time) {
+
+  if (!lgl__camera_active) {
+    return;
+  }
+
+  lgl_transforms_update();
+
+  const lgl_3f_t camera = lgl__camera.position;
+  const float    cotan  = lgl__camera.projection[5]; // cot(fov / 2)
+
+  for(size_t i = 0; i < data_length; i++) {
+    lgl_lods_t *lods = &data[i].lods;
+    if (lods->count == 0) {
+      continue;
+    }
+
+    if (lods->fade < 1) {
+      lods->fade = fminf(lods->fade + delta_time / LGL_LOD_FADE_TIME, 1);
+    }
+
+    // the sphere's diameter over the screen height, from its distance
+    const lgl_4f_t sphere = lgl__world_sphere(&data[i]);
+    const float dx = sphere.x - camera.x, dy = sphere.y - camera.y, dz = sphere.z - camera.z;
+    const float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+    const float size = distance > sphere.w ? sphere.w * cotan / distance : INFINITY;
+
+    const uint8_t level = lgl__lod_level(lods, size);
+    if (level == lods->current) {
+      continue;
+    }
+
+    // a switch during a fade restarts it from the level on screen now
+    lods->previous = lods->current;
+    lods->current  = level;
+    lods->fade     = data[i].render_flags & LGL_FLAG_USE_LOD_FADE ? 0 : 1;
+  }
+}
+
+void lgl_draw(
+    const size_t             data_length,
+    const lgl_render_data_t *data) {
+  lgl_transforms_update();
+  const uint8_t *visible = lgl__cull(data_length, data);
+
+  for(size_t i = 0; i < data_length; i++) {
+
+#if 0 // log render flags
+    debug_log(" ");
+    printf("FLAGS AT data[%lu] { ", i);
+    for(size_t j = 0; j < sizeof(data[i].render_flags)*8; j++) {
+      size_t flag = (data[i].render_flags & (1 << j));
+      printf("%u ", flag ? 1 : 0 );
+    }
+    printf("}\n");
+#endif
+
+    if ((data[i].render_flags & LGL_FLAG_ENABLED) == 0 || !visible[i]) {
+      continue;
+    }
+
+    lgl__draw_object(&data[i],
+        lgl__transform_model (data[i].transform),
+        lgl__transform_normal(data[i].transform));
+  }
+}
+
+void lgl_outline(
+    const size_t       data_length,
+    lgl_render_data_t *data,
+    const GLuint       outline_shader,
+    const float        thickness){
+  lgl_transforms_update();
+
+  for(size_t i = 0; i < data_length; i++) { 
+    if ((data[i].render_flags & LGL_FLAG_USE_STENCIL) == 0) {
+      debug_warn(
+          "object[%lu] is not set to use the stencil buffer, "
+          "but you are trying to outline it.", i);
+    }
+    lgl__stencil_func (GL_NOTEQUAL, 1, 0xFF);
+    lgl__stencil_mask (0x00);
+
+    if ((data[i].render_flags & LGL_FLAG_ENABLED) == 0) {
+      continue;
+    }
+
+    GLuint shader_tmp = data[i].shader;
+
+    lgl__use_program(outline_shader);
+
+    data[i].shader = outline_shader;
+
+    glUniform4f(lgl__uniforms_get(outline_shader)->color,
+        0.0, 1.0, 0.5, 1.0);
+
+    // grow the object along its own axes by scaling the model's basis
+    GLfloat model[16];
+    memcpy(model, lgl__transform_model(data[i].transform), sizeof(model));
+    for(size_t j = 0; j < 12; j++) {
+      model[j] *= (1+thickness);
+    }
+
+    lgl__draw_object(&data[i], model, lgl__transform_normal(data[i].transform));
+
+    data[i].shader = shader_tmp;
+  }
+}
+
+/*Draw queue sort keys, from most to least significant bit:
+
+  opaque:  | 0 | program | diffuse | specular | VAO | flags | depth          |
+  blended: | 1 | inverted depth | program | diffuse | specular | VAO | flags |
+
+  Opaque objects are grouped by state first and drawn front-to-back within a
+  group. Blended objects always go after opaque ones, back-to-front. GL names
+  are masked to fit their field, so two names can share a group. That costs a
+  state change, never correctness.*/
+enum {
+  LGL__KEY_DEPTH_BITS    = 21,
+  LGL__KEY_FLAGS_BITS    = 3,
+  LGL__KEY_VAO_BITS      = 12,
+  LGL__KEY_SPECULAR_BITS = 10,
+  LGL__KEY_DIFFUSE_BITS  = 10,
+  LGL__KEY_PROGRAM_BITS  = 7,
+  LGL__KEY_STATE_BITS    = LGL__KEY_FLAGS_BITS    + LGL__KEY_VAO_BITS     +
+                           LGL__KEY_SPECULAR_BITS + LGL__KEY_DIFFUSE_BITS +
+                           LGL__KEY_PROGRAM_BITS,
+};
+
+static const float LGL__KEY_DEPTH_FAR = 1000.0;
+
+#define LGL__KEY_MASK(bits) ((UINT64_C(1) << (bits)) - 1)
+
+static inline uint64_t lgl__draw_key_state(const lgl_render_data_t *data) {
+  const uint64_t flags = data->render_flags &
+    (LGL_FLAG_USE_STENCIL | LGL_FLAG_USE_WIREFRAME | LGL_FLAG_USE_BLEND);
+
+  uint64_t key = data->shader & LGL__KEY_MASK(LGL__KEY_PROGRAM_BITS);
+  key = (key << LGL__KEY_DIFFUSE_BITS)  | (data->diffuse_map  & LGL__KEY_MASK(LGL__KEY_DIFFUSE_BITS));
+  key = (key << LGL__KEY_SPECULAR_BITS) | (data->specular_map & LGL__KEY_MASK(LGL__KEY_SPECULAR_BITS));
+  key = (key << LGL__KEY_VAO_BITS)      | (data->VAO          & LGL__KEY_MASK(LGL__KEY_VAO_BITS));
+  key = (key << LGL__KEY_FLAGS_BITS)    | ((flags >> 1)       & LGL__KEY_MASK(LGL__KEY_FLAGS_BITS));
+  return key;
+}
+
+static inline uint64_t lgl__draw_key_depth(const lgl_render_data_t *data) {
+  const GLfloat *view = lgl__camera.view;
+  const GLfloat *p    = &lgl__transform_model(data->transform)[12];
+
+  // view space z, the distance in front of the active camera
+  float depth = (view[2] * p[0] + view[6] * p[1] + view[10] * p[2] + view[14]) / LGL__KEY_DEPTH_FAR;
+  if (depth < 0) { depth = 0; }
+  if (depth > 1) { depth = 1; }
+  return (uint64_t)(depth * LGL__KEY_MASK(LGL__KEY_DEPTH_BITS));
+}
+
+static inline uint64_t lgl__draw_key(const lgl_render_data_t *data) {
+  const uint64_t state = lgl__draw_key_state(data);
+  const uint64_t depth = lgl__draw_key_depth(data);
+
+  if (data->render_flags & LGL_FLAG_USE_BLEND) {
+    const uint64_t far_first = LGL__KEY_MASK(LGL__KEY_DEPTH_BITS) - depth;
+    return (UINT64_C(1) << 63) | (far_first << LGL__KEY_STATE_BITS) | state;
+  }
+
+  return (state << LGL__KEY_DEPTH_BITS) | depth;
+}
+
+/*LSD radix sort on the command keys, one byte per pass. Passes where every
+  key has the same byte are skipped. The result ends up in commands.*/
+static void lgl__draw_commands_sort(
+    lgl_draw_command_t *commands,
+    lgl_draw_command_t *scratch,
+    const size_t        count) {
+  lgl_draw_command_t *source      = commands;
+  lgl_draw_command_t *destination = scratch;
+
+  for(unsigned shift = 0; shift < 64; shift += 8) {
+    size_t histogram[256] = {0};
+    for(size_t i = 0; i < count; i++) {
+      histogram[(source[i].key >> shift) & 0xFF]++;
+    }
+
+    if (histogram[(source[0].key >> shift) & 0xFF] == count) {
+      continue;
+    }
+
+    size_t offset = 0;
+    for(size_t digit = 0; digit < 256; digit++) {
+      const size_t digit_count = histogram[digit];
+      histogram[digit] = offset;
+      offset += digit_count;
+    }
+
+    for(size_t i = 0; i < count; i++) {
+      destination[histogram[(source[i].key >> shift) & 0xFF]++] = source[i];
+    }
+
+    lgl_draw_command_t *swap = source;
+    source      = destination;
+    destination = swap;
+  }
+
+  if (source != commands) {
+    memcpy(commands, source, count * sizeof(*commands));
+  }
+}
+
+lgl_draw_queue_t lgl_draw_queue_alloc(const size_t capacity) {
+  lgl_draw_queue_t queue = {0};
+  queue.capacity = capacity;
+  queue.commands = calloc(capacity, sizeof(*queue.commands));
+  queue.scratch  = calloc(capacity, sizeof(*queue.scratch));
+  return queue;
+}
+
+void lgl_draw_queue_free(lgl_draw_queue_t *queue) {
+  free(queue->commands);
+  free(queue->scratch);
+  *queue = (lgl_draw_queue_t){0};
+}
+
+static void lgl__draw_queue_reserve(lgl_draw_queue_t *queue, const size_t count) {
+  if (queue->count + count > queue->capacity) {
+    size_t capacity = queue->capacity ? queue->capacity : 64;
+    while (capacity < queue->count + count) {
+      capacity *= 2;
+    }
+
+    queue->commands = realloc(queue->commands, capacity * sizeof(*queue->commands));
+    queue->scratch  = realloc(queue->scratch,  capacity * sizeof(*queue->scratch));
+    queue->capacity = capacity;
+  }
+}
+
+void lgl_draw_queue_submit(
+    lgl_draw_queue_t        *queue,
+    const size_t             data_length,
+    const lgl_render_data_t *data) {
+
+  lgl_transforms_update();
+  const uint8_t *visible = lgl__cull(data_length, data);
+
+  lgl__draw_queue_reserve(queue, data_length);
+
+  for(size_t i = 0; i < data_length; i++) {
+    if ((data[i].render_flags & LGL_FLAG_ENABLED) == 0 || !visible[i]) {
+      continue;
+    }
+
+    queue->commands[queue->count++] = (lgl_draw_command_t) {
+      .key  = lgl__draw_key(&data[i]),
+      .data = &data[i],
+    };
+  }
+}
+
+void lgl_draw_queue_submit_indices(
+    lgl_draw_queue_t        *queue,
+    const size_t             indices_count,
+    const uint32_t          *indices,
+    const lgl_render_data_t *data) {
+
+  lgl_transforms_update();
+  lgl__draw_queue_reserve(queue, indices_count);
+
+  for(size_t i = 0; i < indices_count; i++) {
+    const lgl_render_data_t *object = &data[indices[i]];
+    if ((object->render_flags & LGL_FLAG_ENABLED) == 0) {
+      continue;
+    }
+
+    if (lgl__object_occluded(object)) {
+      lgl__stats.objects_occluded++;
+      continue;
+    }
+
+    lgl__stats.objects_visible++;
+    queue->commands[queue->count++] = (lgl_draw_command_t) {
+      .key  = lgl__draw_key(object),
+      .data = object,
+    };
+  }
+}
+
+void lgl_draw_queue_flush(lgl_draw_queue_t *queue) {
+  if (queue->count == 0) {
+    return;
+  }
+
+  lgl__draw_commands_sort(queue->commands, queue->scratch, queue->count);
+
+  lgl_transforms_update();
+
+  // opaque pass, front-to-back without blending so early depth testing works
+  lgl__blend(0);
+
+  size_t i = 0;
+  for(; i < queue->count; i++) {
+    const lgl_render_data_t *data = queue->commands[i].data;
+    if (data->render_flags & LGL_FLAG_USE_BLEND) {
+      break;
+    }
+    lgl__draw_object(data,
+        lgl__transform_model (data->transform),
+        lgl__transform_normal(data->transform));
+  }
+
+  // blended pass, back-to-front without writing depth
+  lgl__blend(1);
+
+  if (i < queue->count) {
+    lgl__depth_mask(0);
+    for(; i < queue->count; i++) {
+      const lgl_render_data_t *data = queue->commands[i].data;
+      lgl__draw_object(data,
+          lgl__transform_model (data->transform),
+          lgl__transform_normal(data->transform));
+    }
+    lgl__depth_mask(1);
+  }
+
+  queue->count = 0;
+}
+
+/*Streaming buffers are split into LGL_STREAM_FRAMES regions. The CPU writes
+  into one region while the GPU reads the others, and a fence placed at the
+  end of each frame keeps a region from being reused while it is still in
+  flight.*/
+static int lgl__stream_persistent_supported(void) {
+  return GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage;
+}
+
+lgl_stream_t lgl_stream_alloc(const size_t frame_size) {
+  lgl_stream_t stream = {0};
+  stream.frame_size   = frame_size;
+  stream.persistent   = lgl__stream_persistent_supported();
+
+  const size_t size = frame_size * LGL_STREAM_FRAMES;
+
+  glGenBuffers(1, &stream.buffer);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, stream.buffer);
+
+  if (stream.persistent) {
+    const GLbitfield flags =
+      GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(GL_COPY_WRITE_BUFFER, size, NULL, flags);
+    stream.mapping = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags);
+  } else {
+    glBufferData(GL_COPY_WRITE_BUFFER, size, NULL, GL_STREAM_DRAW);
+  }
+
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  return stream;
+}
+
+void lgl_stream_free(lgl_stream_t *stream) {
+  for(size_t i = 0; i < LGL_STREAM_FRAMES; i++) {
+    if (stream->fences[i]) {
+      glDeleteSync(stream->fences[i]);
+    }
+  }
+
+  if (stream->persistent) {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, stream->buffer);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  }
+
+  glDeleteBuffers(1, &stream->buffer);
+  *stream = (lgl_stream_t){0};
+}
+
+/*Blocks until the GPU is done reading the current region*/
+static void lgl__stream_region_wait(lgl_stream_t *stream) {
+  GLsync fence = stream->fences[stream->frame];
+  if (fence == NULL) {
+    return;
+  }
+
+  GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+  while (status == GL_TIMEOUT_EXPIRED) {
+    lgl__stats.stream_waits++;
+    status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+  }
+
+  glDeleteSync(fence);
+  stream->fences[stream->frame] = NULL;
+}
+
+lgl_stream_allocation_t lgl_stream_push(
+    lgl_stream_t *stream,
+    const size_t  size,
+    const size_t  alignment) {
+
+  if (!stream->in_frame) {
+    lgl__stream_region_wait(stream);
+    stream->in_frame = 1;
+    stream->offset   = 0;
+  }
+
+  size_t offset = stream->offset;
+  if (alignment > 1) {
+    offset = (offset + alignment - 1) / alignment * alignment;
+  }
+
+  if (offset + size > stream->frame_size) {
+    debug_warn("stream buffer is out of space, %lu of %lu bytes used this frame",
+        offset, stream->frame_size);
+    return (lgl_stream_allocation_t){0};
+  }
+
+  stream->offset = offset + size;
+
+  const GLintptr buffer_offset = stream->frame * stream->frame_size + offset;
+
+  if (stream->persistent) {
+    return (lgl_stream_allocation_t) {
+      .pointer = stream->mapping + buffer_offset,
+      .offset  = buffer_offset,
+    };
+  }
+
+  // the region is fenced, so the driver does not need to synchronize either
+  lgl_stream_commit(stream);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, stream->buffer);
+  void *pointer = glMapBufferRange(GL_COPY_WRITE_BUFFER, buffer_offset, size,
+      GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  stream->mapped = 1;
+
+  return (lgl_stream_allocation_t) {
+    .pointer = pointer,
+    .offset  = buffer_offset,
+  };
+}
+
+void lgl_stream_commit(lgl_stream_t *stream) {
+  if (!stream->mapped) {
+    return;
+  }
+
+  glBindBuffer(GL_COPY_WRITE_BUFFER, stream->buffer);
+  glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  stream->mapped = 0;
+}
+
+void lgl_stream_end_frame(lgl_stream_t *stream) {
+  if (!stream->in_frame) {
+    return;
+  }
+
+  lgl_stream_commit(stream);
+
+  stream->fences[stream->frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  stream->frame    = (stream->frame + 1) % LGL_STREAM_FRAMES;
+  stream->in_frame = 0;
+}
+
+/*Stream shared by lgl's own per-frame data*/
+static lgl_stream_t lgl__stream = {0};
+
+static lgl_stream_allocation_t lgl__stream_push(const size_t size, const GLenum alignment_query) {
+  static GLint alignments[2] = {0};
+
+  if (lgl__stream.buffer == 0) {
+    lgl__stream = lgl_stream_alloc(LGL_STREAM_FRAME_SIZE);
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignments[0]);
+    if (GLAD_GL_VERSION_4_3) {
+      glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignments[1]);
+    }
+  }
+
+  GLint alignment = 16;
+  if (alignment_query == GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT) {
+    alignment = alignments[0];
+  } else if (alignment_query == GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT) {
+    alignment = alignments[1];
+  }
+
+  return lgl_stream_push(&lgl__stream, size, alignment);
+}
+
+void lgl_end_frame(void) {
+  lgl_stream_end_frame(&lgl__stream);
+}
+
+/*Per-instance vertex attributes read by phong_instanced_vertex.glsl*/
+typedef struct {
+  lgl__transform_t transform;       // model at locations 3-6, normal matrix at 8-10
+  lgl_2f_t         texture_offset;  // location 7 .xy
+  lgl_2f_t         texture_scale;   // location 7 .zw
+} lgl__instance_t;
+
+enum {
+  LGL__ATTRIBUTE_INSTANCE_MODEL             = 3,
+  LGL__ATTRIBUTE_INSTANCE_TEXTURE_TRANSFORM = 7,
+  LGL__ATTRIBUTE_INSTANCE_NORMAL_MATRIX     = 8,
+};
+
+static struct {
+  lgl_draw_command_t *commands;
+  lgl_draw_command_t *scratch;
+  size_t              commands_capacity;
+} lgl__instancing = {0};
+
+/*The vertex range an object draws at its current level of detail*/
+static inline GLint lgl__lod_first(const lgl_render_data_t *data) {
+  return data->lods.count ? data->lods.levels[data->lods.current].first : 0;
+}
+
+static inline GLsizei lgl__lod_count(const lgl_render_data_t *data) {
+  if (data->lods.count) {
+    return data->lods.levels[data->lods.current].count;
+  }
+  return data->EBO ? data->index_count : data->vertex_count;
+}
+
+/*Two objects can share an instanced draw call when everything but their
+  transform and texture transform matches*/
+static inline int lgl__instance_compatible(
+    const lgl_render_data_t *a,
+    const lgl_render_data_t *b) {
+  const GLint state_flags = LGL_FLAG_USE_STENCIL | LGL_FLAG_USE_WIREFRAME;
+  return
+    a->shader       == b->shader       &&
+    a->VAO          == b->VAO          &&
+    a->vertex_count == b->vertex_count &&
+    lgl__lod_first(a) == lgl__lod_first(b) &&
+    lgl__lod_count(a) == lgl__lod_count(b) &&
+    a->diffuse_map  == b->diffuse_map  &&
+    a->specular_map == b->specular_map &&
+    (a->render_flags & state_flags) == (b->render_flags & state_flags);
+}
+
+/*Points the instance attributes of the bound VAO at a range of the instance
+  buffer. Attribute pointers are VAO state, so this is done per group.*/
+static void lgl__instance_attributes_bind(GLintptr offset, size_t first_instance) {
+  const size_t stride = sizeof(lgl__instance_t);
+  const size_t base   = offset + first_instance * stride;
+
+  glBindBuffer(GL_ARRAY_BUFFER, lgl__stream.buffer);
+
+  for(GLuint column = 0; column < 4; column++) {
+    const GLuint location = LGL__ATTRIBUTE_INSTANCE_MODEL + column;
+    glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, stride,
+        (void*)(base + offsetof(lgl__instance_t, transform.model) + column * 4 * sizeof(GLfloat)));
+    glVertexAttribDivisor(location, 1);
+    glEnableVertexAttribArray(location);
+  }
+
+  for(GLuint column = 0; column < 3; column++) {
+    const GLuint location = LGL__ATTRIBUTE_INSTANCE_NORMAL_MATRIX + column;
+    glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, stride,
+        (void*)(base + offsetof(lgl__instance_t, transform.normal) + column * 4 * sizeof(GLfloat)));
+    glVertexAttribDivisor(location, 1);
+    glEnableVertexAttribArray(location);
+  }
+
+  glVertexAttribPointer(LGL__ATTRIBUTE_INSTANCE_TEXTURE_TRANSFORM, 4, GL_FLOAT, GL_FALSE, stride,
+      (void*)(base + offsetof(lgl__instance_t, texture_offset)));
+  glVertexAttribDivisor(LGL__ATTRIBUTE_INSTANCE_TEXTURE_TRANSFORM, 1);
+  glEnableVertexAttribArray(LGL__ATTRIBUTE_INSTANCE_TEXTURE_TRANSFORM);
 }
 
-void lgl_perspective(
-    float *mat,
-    const float fov,
-    const float aspect,
-    const float near,
-    const float far) {
+void lgl_draw_instanced(
+    const size_t             data_length,
+    const lgl_render_data_t *data) {
 
-  const float cotan = (1.0 / tanf(fov * 0.5));
+  lgl_transforms_update();
 
-  mat[ 0]  = (cotan / aspect);
-  mat[ 5]  = cotan;
-  mat[10]  = -((near + far) / (near - far));
-  mat[11]  = 1.0f;
-  mat[14]  = ((2.0 * near * far) / (near - far));
-}
+  lgl__reserve((void**)&lgl__instancing.commands, &lgl__instancing.commands_capacity,
+      data_length, sizeof(*lgl__instancing.commands));
+  lgl__instancing.scratch = realloc(lgl__instancing.scratch,
+      lgl__instancing.commands_capacity * sizeof(*lgl__instancing.scratch));
 
-GLuint lgl_texture_alloc(const char *imageFile) {
-  debug_log("Loading texture from '%s'", imageFile);
+  const uint8_t *visible = lgl__cull(data_length, data);
 
-  /*create texture*/
-  GLuint texture;
-  glGenTextures(1, &texture);
-  glBindTexture(GL_TEXTURE_2D, texture);
+  // sort by state alone so objects that can share a draw call end up adjacent
+  size_t count = 0;
+  for(size_t i = 0; i < data_length; i++) {
+    if ((data[i].render_flags & LGL_FLAG_ENABLED) == 0 || !visible[i]) {
+      continue;
+    }
 
-  /*set parameters*/
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    // the level of detail goes below the state, so levels split groups last
+    lgl__instancing.commands[count++] = (lgl_draw_command_t) {
+      .key  = lgl__draw_key_state(&data[i]) << 2 | (data[i].lods.current & 3),
+      .data = &data[i],
+    };
+  }
 
-  /*load texture data from file*/
-  int width,
-      height,
-      numChannels;
+  if (count == 0) {
+    return;
+  }
 
-  stbi_set_flip_vertically_on_load(1);
-  unsigned char *data = stbi_load(imageFile, &width, &height, &numChannels, 0);
+  lgl__draw_commands_sort(lgl__instancing.commands, lgl__instancing.scratch, count);
 
-  /*error check*/
-  if (data) {
-    if (numChannels == 4) {
-      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height,
-          0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-      glGenerateMipmap(GL_TEXTURE_2D);
-    } else if (numChannels == 3) {
-      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0,
-          GL_RGB, GL_UNSIGNED_BYTE, data);
-      glGenerateMipmap(GL_TEXTURE_2D);
-    }
-  } else {
-    debug_error("Failed to load texture from '%s'\n", imageFile);
+  lgl_stream_allocation_t allocation = lgl__stream_push(count * sizeof(lgl__instance_t), 0);
+  if (allocation.pointer == NULL) {
+    return;
   }
 
-  /*cleanup*/
-  stbi_image_free(data);
-  glBindTexture(GL_TEXTURE_2D, 0);
-  return texture;
-}
+  lgl__instance_t *instances = allocation.pointer;
+  for(size_t i = 0; i < count; i++) {
+    const lgl_render_data_t *object   = lgl__instancing.commands[i].data;
+    lgl__instance_t         *instance = &instances[i];
 
-GLuint lgl_shader_compile(const char *file_path, GLenum type) {
-  debug_log("compiling shader from '%s'", file_path);
-  file_buffer fb = file_buffer_alloc(file_path);
-  if (fb.error) { // error check
-    debug_error("failed to read shader from '%s'\n", file_path);
+    lgl__transform_copy(&instance->transform, object);
+    instance->texture_offset = object->texture_offset;
+    instance->texture_scale  = object->texture_scale;
   }
 
-  const char* shader_source = fb.text;
+  lgl_stream_commit(&lgl__stream);
 
-  GLuint shader = glCreateShader(type);
-  glShaderSource   (shader, 1, &shader_source, NULL);
-  glCompileShader  (shader);
+  for(size_t first = 0; first < count;) {
+    const lgl_render_data_t *group = lgl__instancing.commands[first].data;
 
-  file_buffer_free(fb);
+    size_t last = first + 1;
+    while (last < count &&
+        lgl__instance_compatible(group, lgl__instancing.commands[last].data)) {
+      last++;
+    }
 
-  { // error check
-    int  success;
-    char  infoLog[512];
+    lgl__use_program(group->shader);
+    lgl__render_flags_apply(group->render_flags);
 
-    glGetShaderiv  (shader, GL_COMPILE_STATUS, &success);
+    lgl__bind_texture(0, group->diffuse_map);
+    lgl__bind_texture(1, group->specular_map);
 
-    if(!success) {
-      glGetShaderInfoLog(shader, 512, NULL, infoLog);
-      debug_error("Error shader compilation failed:\n%s", infoLog);
+    // a VAO holds one mesh, so the group shares its dequantization
+    lgl__position_dequantize(lgl__uniforms_get(group->shader), group);
+
+    lgl__bind_vertex_array(group->VAO);
+    lgl__instance_attributes_bind(allocation.offset, first);
+
+    if (group->EBO) {
+      glDrawElementsInstanced(GL_TRIANGLES, lgl__lod_count(group), GL_UNSIGNED_INT,
+          (void*)(lgl__lod_first(group) * sizeof(uint32_t)), last - first);
+    } else {
+      glDrawArraysInstanced(GL_TRIANGLES, lgl__lod_first(group), lgl__lod_count(group), last - first);
     }
+    lgl__stats.draw_calls++;
+
+    first = last;
   }
 
-  return shader;
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
-GLuint lgl_shader_link (GLuint vertex_shader, GLuint fragment_shader) {
-  GLuint shader = glCreateProgram();
-  glAttachShader  (shader, vertex_shader);
-  glAttachShader  (shader, fragment_shader);
-  glLinkProgram   (shader);
-  glDetachShader  (shader, vertex_shader);
-  glDetachShader  (shader, fragment_shader);
-  glDeleteShader  (vertex_shader);
-  glDeleteShader  (fragment_shader);
-  return shader;
+/*std430 layout of draw_t in phong_indirect_vertex.glsl*/
+typedef struct {
+  lgl__transform_t transform;
+  lgl_2f_t         texture_offset;
+  lgl_2f_t         texture_scale;
+  lgl_3f_t         position_offset;
+  GLfloat          padding0;
+  lgl_3f_t         position_scale;
+  GLfloat          padding1;
+} lgl__batch_draw_t;
+
+enum { LGL__ATTRIBUTE_DRAW_ID = 3 };
+
+typedef struct {
+  GLuint         VBO;
+  size_t         draw;
+  size_t         vertex_first;
+  size_t         index_first;
+  int            shared;
+} lgl__batch_mesh_t;
+
+static int lgl__batch_mesh_compare(const void *a, const void *b) {
+  const lgl__batch_mesh_t *mesh_a = a;
+  const lgl__batch_mesh_t *mesh_b = b;
+  if (mesh_a->VBO != mesh_b->VBO) {
+    return mesh_a->VBO < mesh_b->VBO ? -1 : 1;
+  }
+  return mesh_a->draw < mesh_b->draw ? -1 : 1;
 }
 
-void lgl__buffer_vertex_array (
-    GLuint       *VAO,
-    GLuint       *VBO,
-    GLuint        vertex_count,
-    lgl_vertex_t *vertices) {
-  glGenVertexArrays(1, VAO);
-  glBindVertexArray(*VAO);
-
-  glGenBuffers(1, VBO);
-  glBindBuffer(GL_ARRAY_BUFFER, *VBO);
+int lgl_batch_supported(void) {
+  return GLAD_GL_VERSION_4_3;
+}
 
-  glBufferData(GL_ARRAY_BUFFER, 
-      vertex_count*sizeof(lgl_vertex_t), 
-      vertices, 
-      GL_STATIC_DRAW);
+/*Objects can share a multi-draw call when they only differ in geometry,
+  transform and texture transform*/
+static inline int lgl__batch_compatible(
+    const lgl_render_data_t *a,
+    const lgl_render_data_t *b) {
+  const GLint state_flags = LGL_FLAG_USE_STENCIL | LGL_FLAG_USE_WIREFRAME;
+  return
+    a->shader        == b->shader        &&
+    a->vertex_format == b->vertex_format &&
+    a->diffuse_map   == b->diffuse_map   &&
+    a->specular_map  == b->specular_map  &&
+    (a->render_flags & state_flags) == (b->render_flags & state_flags);
+}
 
-  glVertexAttribPointer(
-      0, 3, GL_FLOAT, GL_FALSE, sizeof(lgl_vertex_t),
-      (void*)offsetof(lgl_vertex_t, position));
+static inline size_t lgl__vertex_size(const GLint vertex_format) {
+  return vertex_format == LGL_VERTEX_FORMAT_PACKED ? sizeof(lgl_vertex_packed_t) : sizeof(lgl_vertex_t);
+}
 
-  glVertexAttribPointer(
-      1, 3, GL_FLOAT, GL_FALSE, sizeof(lgl_vertex_t),
-      (void*)offsetof(lgl_vertex_t, normal));
+lgl_batch_t lgl_batch_alloc(
+    const size_t             data_length,
+    const lgl_render_data_t *data) {
+  lgl_batch_t batch = {0};
 
-  glVertexAttribPointer(
-      2, 2, GL_FLOAT, GL_FALSE, sizeof(lgl_vertex_t),
-      (void*)offsetof(lgl_vertex_t, texture_coordinates));
+  if (!lgl_batch_supported()) {
+    debug_warn("multi-draw indirect needs OpenGL 4.3, batch will use lgl_draw");
+    return batch;
+  }
 
-  glEnableVertexAttribArray(0);
-  glEnableVertexAttribArray(1);
-  glEnableVertexAttribArray(2);
-}
+  if (data_length == 0) {
+    return batch;
+  }
 
-void lgl_outline(
-    const size_t       data_length,
-    lgl_render_data_t *data,
-    const GLuint       outline_shader,
-    const float        thickness){
-  for(size_t i = 0; i < data_length; i++) { 
-    if ((data[i].render_flags & LGL_FLAG_USE_STENCIL) == 0) {
-      debug_warn(
-          "object[%lu] is not set to use the stencil buffer, "
-          "but you are trying to outline it.", i);
+  batch.draw_count = data_length;
+  batch.order        = calloc(data_length, sizeof(*batch.order));
+  batch.index_firsts = calloc(data_length, sizeof(*batch.index_firsts));
+  batch.groups     = calloc(data_length, sizeof(*batch.groups));
+  batch.commands   = calloc(data_length, sizeof(*batch.commands));
+
+  GLuint            *draw_ids = calloc(data_length, sizeof(*draw_ids));
+  lgl__batch_mesh_t *meshes   = calloc(data_length, sizeof(*meshes));
+
+  { // order draws by state so each group is a contiguous range of commands
+    lgl_draw_command_t *sorted  = calloc(data_length, sizeof(*sorted));
+    lgl_draw_command_t *scratch = calloc(data_length, sizeof(*scratch));
+    // the batch draws every mesh from its format's VAO, so sort on the
+    // format where the key has the object's own VAO
+    const uint64_t vao_bits = LGL__KEY_MASK(LGL__KEY_VAO_BITS) << LGL__KEY_FLAGS_BITS;
+    for(size_t i = 0; i < data_length; i++) {
+      sorted[i] = (lgl_draw_command_t) {
+        .key  = (lgl__draw_key_state(&data[i]) & ~vao_bits) |
+          (uint64_t)data[i].vertex_format << LGL__KEY_FLAGS_BITS,
+        .data = &data[i],
+      };
     }
-    glStencilFunc (GL_NOTEQUAL, 1, 0xFF);
-    glStencilMask (0x00);
+    lgl__draw_commands_sort(sorted, scratch, data_length);
 
-    GLuint shader_tmp = data[i].shader;
+    for(size_t i = 0; i < data_length; i++) {
+      batch.order[i] = sorted[i].data - data;
+    }
 
-    glUseProgram(outline_shader);
+    free(sorted);
+    free(scratch);
+  }
 
-    data[i].shader = outline_shader;
+  for(size_t i = 0; i < data_length; i++) {
+    const lgl_render_data_t *object = &data[batch.order[i]];
+    if (batch.groups_count == 0 ||
+        !lgl__batch_compatible(&data[batch.order[batch.groups[batch.groups_count - 1].first]], object)) {
+      batch.groups[batch.groups_count++] = (lgl_batch_group_t) {
+        .first         = i,
+        .vertex_format = object->vertex_format,
+      };
+    }
+    batch.groups[batch.groups_count - 1].count++;
+  }
 
-    glUniform4f(glGetUniformLocation(outline_shader, "u_color"),
-        0.0, 1.0, 0.5, 1.0);
+  // objects built from the same VBO share one copy of its vertices
+  for(size_t i = 0; i < data_length; i++) {
+    meshes[i] = (lgl__batch_mesh_t) { .VBO = data[batch.order[i]].VBO, .draw = i };
+  }
+  qsort(meshes, data_length, sizeof(*meshes), lgl__batch_mesh_compare);
 
-    lgl_3f_t scale_tmp = data[i].scale;
-    data[i].scale.x *= (1+thickness);
-    data[i].scale.y *= (1+thickness);
-    data[i].scale.z *= (1+thickness);
+  // each distinct mesh gets a range of its format's vertex buffer and of the
+  // index buffer, lgl_batch_draw picks each draw's level of detail within it
+  size_t vertex_counts[LGL_VERTEX_FORMAT_COUNT] = {0}, index_count = 0;
+  for(size_t i = 0; i < data_length; i++) {
+    const size_t             draw   = meshes[i].draw;
+    const lgl_render_data_t *object = &data[batch.order[draw]];
 
-    lgl_draw(1, &data[i]);
+    if (i > 0 && meshes[i - 1].VBO == meshes[i].VBO) {
+      meshes[i].vertex_first = meshes[i - 1].vertex_first;
+      meshes[i].index_first  = meshes[i - 1].index_first;
+      meshes[i].shared       = 1;
+    } else {
+      meshes[i].vertex_first = vertex_counts[object->vertex_format];
+      meshes[i].index_first  = index_count;
+      vertex_counts[object->vertex_format] += object->vertex_count;
+      index_count           += object->EBO ? object->index_count : object->vertex_count;
+    }
 
-    data[i].scale  = scale_tmp;
-    data[i].shader = shader_tmp;
+    batch.commands[draw] = (lgl_draw_elements_indirect_t) {
+      .count          = object->EBO ? object->index_count : object->vertex_count,
+      .instance_count = 1,
+      .first_index    = meshes[i].index_first,
+      .base_vertex    = meshes[i].vertex_first,
+      .base_instance  = draw,
+    };
+    batch.index_firsts[draw] = meshes[i].index_first;
+    draw_ids[draw]           = draw;
   }
-}
 
-void lgl_draw(
-    const size_t             data_length,
-    const lgl_render_data_t *data) {
+  glGenBuffers(1, &batch.index_buffer);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, batch.index_buffer);
+  glBufferData(GL_COPY_WRITE_BUFFER, index_count * sizeof(uint32_t), NULL, GL_STATIC_DRAW);
+
+  // copy every distinct mesh's indices into the shared buffer on the GPU,
+  // meshes without indices get sequential ones
   for(size_t i = 0; i < data_length; i++) {
+    if (meshes[i].shared) {
+      continue;
+    }
 
-    glUseProgram(data[i].shader);
+    const lgl_render_data_t *object = &data[batch.order[meshes[i].draw]];
 
-#if 0 // log render flags
-    debug_log(" ");
-    printf("FLAGS AT data[%lu] { ", i);
-    for(size_t j = 0; j < sizeof(data[i].render_flags)*8; j++) {
-      size_t flag = (data[i].render_flags & (1 << j));
-      printf("%u ", flag ? 1 : 0 );
+    if (object->EBO) {
+      glBindBuffer(GL_COPY_READ_BUFFER, object->EBO);
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+          0,
+          meshes[i].index_first * sizeof(uint32_t),
+          object->index_count   * sizeof(uint32_t));
+    } else {
+      uint32_t *sequential = malloc(object->vertex_count * sizeof(*sequential));
+      for(size_t j = 0; j < object->vertex_count; j++) {
+        sequential[j] = j;
+      }
+      glBufferSubData(GL_COPY_WRITE_BUFFER,
+          meshes[i].index_first * sizeof(uint32_t),
+          object->vertex_count  * sizeof(uint32_t),
+          sequential);
+      free(sequential);
     }
-    printf("}\n");
-#endif
+  }
 
-    if ((data[i].render_flags & LGL_FLAG_ENABLED) == 0) {
+  // draw IDs come from an instanced attribute and each command's base instance
+  glGenBuffers(1, &batch.draw_id_buffer);
+  glBindBuffer(GL_ARRAY_BUFFER, batch.draw_id_buffer);
+  glBufferData(GL_ARRAY_BUFFER, data_length * sizeof(*draw_ids), draw_ids, GL_STATIC_DRAW);
+
+  // a VAO has one attribute layout, so every vertex format in use gets its
+  // own vertex buffer and VAO, sharing the index and draw ID buffers
+  for(GLint format = 0; format < LGL_VERTEX_FORMAT_COUNT; format++) {
+    if (vertex_counts[format] == 0) {
       continue;
     }
 
-    if (data[i].render_flags & LGL_FLAG_USE_WIREFRAME) {
-      glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-    } else {
-      glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    const size_t vertex_size = lgl__vertex_size(format);
+
+    glGenBuffers(1, &batch.vertex_buffers[format]);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, batch.vertex_buffers[format]);
+    glBufferData(GL_COPY_WRITE_BUFFER, vertex_counts[format] * vertex_size, NULL, GL_STATIC_DRAW);
+
+    for(size_t i = 0; i < data_length; i++) {
+      const lgl_render_data_t *object = &data[batch.order[meshes[i].draw]];
+      if (meshes[i].shared || object->vertex_format != format) {
+        continue;
+      }
+
+      glBindBuffer(GL_COPY_READ_BUFFER, meshes[i].VBO);
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+          0,
+          meshes[i].vertex_first * vertex_size,
+          object->vertex_count   * vertex_size);
     }
 
-    if (data[i].render_flags & LGL_FLAG_USE_STENCIL) {
-      glStencilMask(0xFF);
+    glGenVertexArrays(1, &batch.VAOs[format]);
+    lgl__bind_vertex_array(batch.VAOs[format]);
+
+    glBindBuffer(GL_ARRAY_BUFFER, batch.vertex_buffers[format]);
+    if (format == LGL_VERTEX_FORMAT_PACKED) {
+      lgl__vertex_attributes_set_packed();
     } else {
-      glStencilMask(0x00);
+      lgl__vertex_attributes_set();
     }
 
-    GLfloat projection[16] = {
-      1.0,  0.0,  0.0,  0.0,
-      0.0,  1.0,  0.0,  0.0,
-      0.0,  0.0,  1.0,  0.0,
-      0.0,  0.0,  0.0,  1.0,
-    };
+    glBindBuffer(GL_ARRAY_BUFFER, batch.draw_id_buffer);
+    glVertexAttribIPointer(LGL__ATTRIBUTE_DRAW_ID, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+    glVertexAttribDivisor(LGL__ATTRIBUTE_DRAW_ID, 1);
+    glEnableVertexAttribArray(LGL__ATTRIBUTE_DRAW_ID);
 
-    const float aspect = data[i].frame->width / data[i].frame->height;
-    lgl_perspective(projection, 80 * (3.14159/180.0), aspect, 0.001, 1000);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, batch.index_buffer);
+  }
 
-    GLfloat model[16] = {
-      data[i].scale.x,    0.0,                0.0,                0.0,
-      0.0,                data[i].scale.y,    0.0,                0.0,
-      0.0,                0.0,                data[i].scale.z,    0.0,
-      data[i].position.x, data[i].position.y, data[i].position.z, 1.0,
-    };
+  glBindBuffer(GL_COPY_READ_BUFFER,  0);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-    GLfloat mvp[16] = {
-      1.0,  0.0,  0.0,  0.0,
-      0.0,  1.0,  0.0,  0.0,
-      0.0,  0.0,  1.0,  0.0,
-      0.0,  0.0,  0.0,  1.0,
-    };
+  glGenBuffers(1, &batch.indirect_buffer);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, batch.indirect_buffer);
+  glBufferData(GL_DRAW_INDIRECT_BUFFER,
+      data_length * sizeof(*batch.commands),
+      batch.commands,
+      GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
 
-    lgl__mat4_multiply(mvp, model, projection);
-
-    GLint mvp_location = glGetUniformLocation(data[i].shader, "u_mvp");
-    glUniformMatrix4fv(mvp_location, 1, GL_FALSE, mvp);
-
-    // textures
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, data[i].diffuse_map);
-
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, data[i].specular_map);
-
-    glUniform2f(glGetUniformLocation(data[i].shader, "u_texture_offset"),
-        data[i].texture_offset.x,
-        data[i].texture_offset.y);
-
-    glUniform2f(glGetUniformLocation(data[i].shader, "u_texture_scale"),
-        data[i].texture_scale.x,
-        data[i].texture_scale.y);
-
-    // other material properties
-    glUniform1i(glGetUniformLocation(data[i].shader, "u_material.diffuse"), 0);
-    glUniform1i(glGetUniformLocation(data[i].shader, "u_material.specular"), 1);
-    glUniform1f(glGetUniformLocation(data[i].shader, "u_material.shininess"), 8.0f);
-
-    glUniform3f(
-        glGetUniformLocation(data[i].shader, "u_ambient_light"), 
-        0.2,
-        0.2,
-        0.2);
-
-    // lighting uniforms
-    for(GLuint light = 0; light < data[i].lights_count; light++) {
-      glUniform1ui(glGetUniformLocation(data[i].shader, "u_lights_count"),
-          data[i].lights_count);
-      {
-        char uniform_name[64] = {0};
-        snprintf(uniform_name, sizeof(uniform_name), "u_lights[%d].type", light);
-        glUniform1i(glGetUniformLocation(data[i].shader, uniform_name),
-            data[i].lights[light].type);
-      }
-      {
-        char uniform_name[64] = {0};
-        snprintf(uniform_name, sizeof(uniform_name), "u_lights[%d].position", light);
-        glUniform3f(glGetUniformLocation(data[i].shader, uniform_name),
-            data[i].lights[light].position.x,
-            data[i].lights[light].position.y,
-            data[i].lights[light].position.z);
-      }
-      {
-        char uniform_name[64] = {0};
-        snprintf(uniform_name, sizeof(uniform_name), "u_lights[%d].direction", light);
-        glUniform3f(glGetUniformLocation(data[i].shader, uniform_name),
-            data[i].lights[light].direction.x,
-            data[i].lights[light].direction.y,
-            data[i].lights[light].direction.z);
-      }
-      {
-        char uniform_name[64] = {0};
-        snprintf(uniform_name, sizeof(uniform_name), "u_lights[%d].cut_off", light);
-        glUniform1f(glGetUniformLocation(data[i].shader, uniform_name),
-            data[i].lights[light].cut_off);
-      }
-      {
-        char uniform_name[64] = {0};
-        snprintf(uniform_name, sizeof(uniform_name), "u_lights[%d].outer_cut_off", light);
-        glUniform1f(glGetUniformLocation(data[i].shader, uniform_name),
-            data[i].lights[light].outer_cut_off);
-      }
-      {
-        char uniform_name[64] = {0};
-        snprintf(uniform_name, sizeof(uniform_name), "u_lights[%d].constant", light);
-        glUniform1f(glGetUniformLocation(data[i].shader, uniform_name),
-            data[i].lights[light].constant);
-      }
-      {
-        char uniform_name[64] = {0};
-        snprintf(uniform_name, sizeof(uniform_name), "u_lights[%d].linear", light);
-        glUniform1f(glGetUniformLocation(data[i].shader, uniform_name),
-            data[i].lights[light].linear);
-      }
-      {
-        char uniform_name[64] = {0};
-        snprintf(uniform_name, sizeof(uniform_name), "u_lights[%d].quadratic", light);
-        glUniform1f(glGetUniformLocation(data[i].shader, uniform_name),
-            data[i].lights[light].quadratic);
-      }
-      {
-        char uniform_name[64] = {0};
-        snprintf(uniform_name, sizeof(uniform_name), "u_lights[%d].diffuse", light);
-        glUniform3f(glGetUniformLocation(data[i].shader, uniform_name),
-            data[i].lights[light].diffuse.x,
-            data[i].lights[light].diffuse.y,
-            data[i].lights[light].diffuse.z);
-      }
-      {
-        char uniform_name[64] = {0};
-        snprintf(uniform_name, sizeof(uniform_name), "u_lights[%d].specular", light);
-        glUniform3f(glGetUniformLocation(data[i].shader, uniform_name),
-            data[i].lights[light].specular.x,
-            data[i].lights[light].specular.y,
-            data[i].lights[light].specular.z);
-      }
+  free(draw_ids);
+  free(meshes);
+
+  return batch;
+}
+
+void lgl_batch_free(lgl_batch_t *batch) {
+  if (batch->index_buffer) {
+    glDeleteVertexArrays(LGL_VERTEX_FORMAT_COUNT, batch->VAOs);
+    glDeleteBuffers(LGL_VERTEX_FORMAT_COUNT, batch->vertex_buffers);
+    glDeleteBuffers(1, &batch->index_buffer);
+    glDeleteBuffers(1, &batch->draw_id_buffer);
+    glDeleteBuffers(1, &batch->indirect_buffer);
+    lgl_state_invalidate();
+  }
+  free(batch->order);
+  free(batch->index_firsts);
+  free(batch->groups);
+  free(batch->commands);
+  *batch = (lgl_batch_t){0};
+}
+
+void lgl_batch_draw(
+    lgl_batch_t             *batch,
+    const size_t             data_length,
+    const lgl_render_data_t *data) {
+
+  if (batch->index_buffer == 0 || data_length != batch->draw_count) {
+    lgl_draw(data_length, data);
+    return;
+  }
+
+  lgl_transforms_update();
+  const uint8_t *visible = lgl__cull(data_length, data);
+
+  // per-draw data and visibility for this frame
+  const size_t draws_size = data_length * sizeof(lgl__batch_draw_t);
+
+  lgl_stream_allocation_t allocation =
+    lgl__stream_push(draws_size, GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT);
+  if (allocation.pointer == NULL) {
+    return;
+  }
+
+  lgl__batch_draw_t *draws = allocation.pointer;
+  for(size_t i = 0; i < data_length; i++) {
+    const lgl_render_data_t *object = &data[batch->order[i]];
+    lgl__transform_copy(&draws[i].transform, object);
+    draws[i].texture_offset = object->texture_offset;
+    draws[i].texture_scale  = object->texture_scale;
+    lgl__position_dequantization(object, &draws[i].position_offset, &draws[i].position_scale);
+    batch->commands[i].instance_count =
+      (object->render_flags & LGL_FLAG_ENABLED) && visible[batch->order[i]] ? 1 : 0;
+
+    // one command per draw leaves no room for the previous level, so
+    // levels switch without fading
+    if (object->lods.count) {
+      const lgl_lod_t *lod = &object->lods.levels[object->lods.current];
+      batch->commands[i].count       = lod->count;
+      batch->commands[i].first_index = batch->index_firsts[i] + lod->first;
     }
+  }
+
+  lgl_stream_commit(&lgl__stream);
+
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, batch->indirect_buffer);
+  glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0,
+      data_length * sizeof(*batch->commands),
+      batch->commands);
+
+  glBindBufferRange(GL_SHADER_STORAGE_BUFFER, LGL__BINDING_DRAWS,
+      lgl__stream.buffer, allocation.offset, draws_size);
+
+  for(size_t i = 0; i < batch->groups_count; i++) {
+    const lgl_batch_group_t *group  = &batch->groups[i];
+    const lgl_render_data_t *object = &data[batch->order[group->first]];
+
+    lgl__bind_vertex_array(batch->VAOs[group->vertex_format]);
+    lgl__use_program(object->shader);
+    lgl__render_flags_apply(object->render_flags);
 
-    glBindVertexArray(data[i].VAO);
-    glDrawArrays(GL_TRIANGLES, 0, data[i].vertex_count);
-    glUseProgram(0);
+    lgl__bind_texture(0, object->diffuse_map);
+    lgl__bind_texture(1, object->specular_map);
 
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+        (void*)(group->first * sizeof(lgl_draw_elements_indirect_t)),
+        group->count,
+        0);
+    lgl__stats.draw_calls++;
   }
+
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
 }
 
 lgl_frame_t lgl_frame_alloc(void) {
@@ -388,11 +3143,10 @@ lgl_frame_t lgl_frame_alloc(void) {
            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
 
            glGenTextures   (1, &framebuffer_color_texture);
-           glBindTexture   (GL_TEXTURE_2D, framebuffer_color_texture);
+           lgl__bind_texture(0, framebuffer_color_texture);
            glTexImage2D    (GL_TEXTURE_2D, 0, GL_RGB, 640, 480, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
            glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
            glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-           glBindTexture   (GL_TEXTURE_2D, framebuffer_color_texture);
 
            glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
                framebuffer_color_texture, 0);
@@ -443,22 +3197,22 @@ lgl_frame_t lgl_frame_alloc(void) {
     frame.height          = 480;
     frame.diffuse_map     = framebuffer_color_texture;
     frame.shader          = shader_frame;
-    frame.vertices        = frame_vertices;
     frame.vertex_count    = frame_vertices_count;
     frame.render_flags    = LGL_FLAG_ENABLED;
 
     lgl__buffer_vertex_array(
         &frame.VAO,
         &frame.VBO,
+        NULL,
         frame.vertex_count,
-        frame.vertices);
+        frame_vertices);
   }
   return frame;
 }
 
 void lgl_frame_draw(const lgl_frame_t *frame) {
 
-  glUseProgram(frame->shader);
+  lgl__use_program(frame->shader);
 
 #if 0 // log render flags
   debug_log(" ");
@@ -475,26 +3229,27 @@ void lgl_frame_draw(const lgl_frame_t *frame) {
   }
 
   if (frame->render_flags & LGL_FLAG_USE_WIREFRAME) {
-    glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+    lgl__polygon_mode(GL_LINE);
   } else {
-    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    lgl__polygon_mode(GL_FILL);
   }
 
-  glStencilMask(0xFF);
+  lgl__stencil_mask(0xFF);
 
   // textures
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, frame->diffuse_map);
+  lgl__bind_texture(0, frame->diffuse_map);
 
-  glBindVertexArray(frame->VAO);
+  lgl__bind_vertex_array(frame->VAO);
   glDrawArrays(GL_TRIANGLES, 0, frame->vertex_count);
-  glUseProgram(0);
-
+  lgl__stats.draw_calls++;
 }
 
 
 lgl_render_data_t lgl_quad_alloc(void) {
-  lgl_render_data_t quad = {0};
+  lgl_mesh_t mesh = lgl_mesh_find("lgl:quad");
+  if (mesh != LGL_MESH_NONE) {
+    return lgl_mesh_instance(mesh);
+  }
 
   enum { quad_vertices_count = 6 };
   lgl_vertex_t quad_vertices[quad_vertices_count] = { 
@@ -508,28 +3263,21 @@ lgl_render_data_t lgl_quad_alloc(void) {
     { { LGL__RIGHT, LGL__UP,   0.0 }, lgl_3f_forward(1.0), { 1.0, 1.0 } },
   };
 
-  quad.vertices        = quad_vertices;
-  quad.vertex_count    = quad_vertices_count;
-
-  quad.scale           = lgl_3f_one(1.0);
-  quad.position        = lgl_3f_zero();
-  quad.rotation        = lgl_4f_zero();
+  // the shared corners are welded, 4 vertices and 6 indices
+  mesh = lgl_mesh_upload("lgl:quad",
+      quad_vertices_count, quad_vertices, 0, NULL, LGL_VERTEX_FORMAT_PACKED);
 
-  quad.texture_offset  = lgl_2f_zero();
-  quad.texture_scale   = lgl_2f_one(1.0);
-
-  quad.render_flags    = LGL_FLAG_ENABLED;
-
-  lgl__buffer_vertex_array(
-      &quad.VAO,
-      &quad.VBO,
-      quad.vertex_count,
-      quad.vertices);
+  // the quad's objects hold the only references, the last one frees it
+  lgl_render_data_t quad = lgl_mesh_instance(mesh);
+  lgl_mesh_release(mesh);
   return quad;
 }
 
 lgl_render_data_t lgl_cube_alloc(void) {
-  lgl_render_data_t cube = {0};
+  lgl_mesh_t mesh = lgl_mesh_find("lgl:cube");
+  if (mesh != LGL_MESH_NONE) {
+    return lgl_mesh_instance(mesh);
+  }
 
   enum { cube_vertices_count = 36 };
   lgl_vertex_t cube_vertices[cube_vertices_count] = { 
@@ -583,22 +3331,182 @@ lgl_render_data_t lgl_cube_alloc(void) {
     { { LGL__LEFT,  LGL__UP,   LGL__BACK    }, lgl_3f_up(1.0),      { 0.0, 1.0 } },
   };
 
-  cube.vertices       = cube_vertices;
-  cube.vertex_count   = cube_vertices_count;
+  // each face's shared corners are welded, 24 vertices and 36 indices. all
+  // its values are exact in the packed format
+  mesh = lgl_mesh_upload("lgl:cube",
+      cube_vertices_count, cube_vertices, 0, NULL, LGL_VERTEX_FORMAT_PACKED);
+
+  lgl_render_data_t cube = lgl_mesh_instance(mesh);
+  lgl_mesh_release(mesh);
+  return cube;
+}
+
+lgl_render_data_t lgl_mesh_alloc(
+    const size_t        vertex_count,
+    const lgl_vertex_t *vertices,
+    const size_t        index_count,
+    const uint32_t     *indices,
+    const GLint         vertex_format) {
+  const lgl_mesh_t mesh =
+    lgl_mesh_upload(NULL, vertex_count, vertices, index_count, indices, vertex_format);
+
+  // the object's reference is the only one
+  lgl_render_data_t data = lgl_mesh_instance(mesh);
+  lgl_mesh_release(mesh);
+  return data;
+}
 
-  cube.scale          = lgl_3f_one(1.0);
-  cube.position       = lgl_3f_zero();
-  cube.rotation       = lgl_4f_zero();
+size_t lgl_lmod_alloc(
+    const char        *path,
+    const GLint        vertex_format,
+    const size_t       data_capacity,
+    lgl_render_data_t *data) {
 
-  cube.texture_offset = lgl_2f_zero();
-  cube.texture_scale  = lgl_2f_one(1.0);
+  const int file = open(path, O_RDONLY);
+  if (file < 0) {
+    debug_error("failed to open %s", path);
+    return 0;
+  }
 
-  cube.render_flags   = LGL_FLAG_ENABLED;
+  struct stat status;
+  if (fstat(file, &status) != 0 || status.st_size == 0) {
+    debug_error("failed to read %s", path);
+    close(file);
+    return 0;
+  }
 
-  lgl__buffer_vertex_array(
-      &cube.VAO,
-      &cube.VBO,
-      cube.vertex_count,
-      cube.vertices);
-  return cube;
+  // the parser reads the file once, front to back, straight from the page cache
+  const size_t length = status.st_size;
+  char *text = mmap(NULL, length, PROT_READ, MAP_PRIVATE, file, 0);
+  close(file);
+  if (text == MAP_FAILED) {
+    debug_error("failed to map %s", path);
+    return 0;
+  }
+  madvise(text, length, MADV_SEQUENTIAL);
+
+  lgl_lmod_t  *meshes = NULL;
+  const size_t meshes_count = lgl_lmod_parse(text, length, &meshes);
+  munmap(text, length);
+
+  if (meshes_count == 0) {
+    debug_error("%s has no meshes", path);
+    return 0;
+  }
+
+  size_t count = meshes_count;
+  if (count > data_capacity) {
+    debug_warn("%s has %lu meshes, loading the first %lu", path, meshes_count, data_capacity);
+    count = data_capacity;
+  }
+
+  for(size_t i = 0; i < count; i++) {
+    const lgl_lmod_t *mesh = &meshes[i];
+
+    char *name = malloc(strlen(path) + strlen(mesh->name) + 2);
+    sprintf(name, "%s:%s", path, mesh->name);
+
+    // loaded before, share its buffers
+    const lgl_mesh_t loaded = lgl_mesh_find(name);
+    if (loaded != LGL_MESH_NONE) {
+      free(name);
+      data[i] = lgl_mesh_instance(loaded);
+      continue;
+    }
+
+    lgl_render_data_t uploaded = {0};
+    if (mesh->levels_count > 1) {
+      uploaded.lods = (lgl_lods_t) { .count = mesh->levels_count, .fade = 1 };
+      memcpy(uploaded.lods.levels, mesh->levels, sizeof(mesh->levels));
+    }
+
+    // indices are drawn in the order the file lists them, lmod_optimize
+    // has ordered them already
+    lgl__buffer_mesh_indexed(&uploaded, mesh->vertex_count, mesh->vertices,
+        mesh->index_count, mesh->indices, vertex_format);
+
+    const lgl_mesh_t handle = lgl__mesh_register(name, &uploaded);
+    free(name);
+
+    data[i] = lgl_mesh_instance(handle);
+    lgl_mesh_release(handle);
+  }
+
+  lgl_lmod_free(meshes_count, meshes);
+  return count;
+}
+
+size_t lgl_lmodb_alloc(
+    const char        *path,
+    const size_t       data_capacity,
+    lgl_render_data_t *data) {
+
+  const int file = open(path, O_RDONLY);
+  if (file < 0) {
+    debug_error("failed to open %s", path);
+    return 0;
+  }
+
+  struct stat status;
+  if (fstat(file, &status) != 0) {
+    debug_error("failed to read %s", path);
+    close(file);
+    return 0;
+  }
+
+  const size_t length = status.st_size;
+  const char *mapped = length ? mmap(NULL, length, PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED;
+  close(file);
+  if (mapped == MAP_FAILED) {
+    debug_error("failed to map %s", path);
+    return 0;
+  }
+  madvise((void*)mapped, length, MADV_WILLNEED);
+
+  const lgl_lmodb_mesh_t *table = lgl_lmodb_validate(mapped, length, LGL_LMODB_VERIFY);
+  if (table == NULL) {
+    debug_error("failed to load %s", path);
+    munmap((void*)mapped, length);
+    return 0;
+  }
+
+  const lgl_lmodb_header_t *header = (const lgl_lmodb_header_t*)mapped;
+
+  size_t count = header->meshes_count;
+  if (count > data_capacity) {
+    debug_warn("%s has %lu meshes, loading the first %lu", path, count, data_capacity);
+    count = data_capacity;
+  }
+
+  for(size_t i = 0; i < count; i++) {
+    const lgl_lmodb_mesh_t *mesh = &table[i];
+
+    // keyed by content, the same meshes under another path are shared
+    char name[sizeof(mesh->name) + 32];
+    snprintf(name, sizeof(name), "lmodb:%016llx:%s", (unsigned long long)header->hash, mesh->name);
+
+    lgl_mesh_t handle = lgl_mesh_find(name);
+    if (handle == LGL_MESH_NONE) {
+      lgl_render_data_t uploaded = { .bounds = mesh->bounds };
+      if (mesh->levels_count > 1) {
+        uploaded.lods = (lgl_lods_t) { .count = mesh->levels_count, .fade = 1 };
+        memcpy(uploaded.lods.levels, mesh->levels, sizeof(mesh->levels));
+      }
+
+      // the sections go to the driver straight from the page cache
+      lgl__buffer_mesh_raw(&uploaded,
+          mesh->vertex_count, mapped + mesh->vertices_offset,
+          mesh->index_count,  (const uint32_t*)(mapped + mesh->indices_offset),
+          mesh->vertex_format);
+
+      handle = lgl__mesh_register(name, &uploaded);
+      data[i] = lgl_mesh_instance(handle);
+      lgl_mesh_release(handle);
+    } else {
+      data[i] = lgl_mesh_instance(handle);
+    }
+  }
+
+  munmap((void*)mapped, length);
+  return count;
 }
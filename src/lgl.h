@@ -17,11 +17,15 @@ extern "C" {
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 #include <math.h>
 
 #include "stb_image.h"
 #include "blib/blib_log.h"
 
+#define LGL_LIGHTS_MAX 32 // keep in sync with LIGHTS_MAX in phong_fragment.glsl
+
 typedef struct {
   float          x;
   float          y;
@@ -46,23 +50,43 @@ typedef struct {
   lgl_2f_t       texture_coordinates;
 } lgl_vertex_t;
 
+/*16 byte vertex for meshes uploaded with LGL_VERTEX_FORMAT_PACKED.
+  Positions are unsigned normalized fractions of the mesh's bounds, normals
+  are GL_INT_2_10_10_10_REV and texture coordinates are half floats.*/
+typedef struct {
+  uint16_t       position[4];     // w is padding
+  uint32_t       normal;
+  uint16_t       texture_coordinates[2];
+} lgl_vertex_packed_t;
+
+enum {
+  LGL_VERTEX_FORMAT_FLOAT,        // lgl_vertex_t
+  LGL_VERTEX_FORMAT_PACKED,       // lgl_vertex_packed_t, dequantized against bounds
+  LGL_VERTEX_FORMAT_COUNT,
+};
+
+/*Matches the std140 layout of light_t in phong_fragment.glsl so an array of
+  lights can be copied straight into the lights uniform buffer*/
 typedef struct {
-  int            type;
   lgl_3f_t       position;
-  lgl_3f_t       direction;
   float          cut_off;
+  lgl_3f_t       direction;
   float          outer_cut_off;
+  lgl_3f_t       diffuse;
   float          constant;
+  lgl_3f_t       specular;
   float          linear;
+  int            type;
   float          quadratic;
-  lgl_3f_t       diffuse;
-  lgl_3f_t       specular;
+  float          _padding[2];
 } lgl_light_t;
 
 enum {
   LGL_FLAG_ENABLED       = 1 << 0, // if not enabled, the renderer will draw this object
   LGL_FLAG_USE_STENCIL   = 1 << 1,
   LGL_FLAG_USE_WIREFRAME = 1 << 2,
+  LGL_FLAG_USE_BLEND     = 1 << 3, // drawn back-to-front after opaque objects by the draw queue
+  LGL_FLAG_USE_LOD_FADE  = 1 << 4, // dither between levels of detail instead of switching at once
 };
 
 typedef struct {
@@ -71,58 +95,475 @@ typedef struct {
   float          height;
   GLuint         VAO;
   GLuint         VBO;
-  lgl_vertex_t  *vertices;
   size_t         vertex_count;
   GLuint         shader;
   GLuint         diffuse_map;
   GLint          render_flags;
 } lgl_frame_t;
 
+/*Bounds of a mesh in object space, computed when it is uploaded. A radius
+  of 0 means the bounds are unknown, and the object is never culled.*/
 typedef struct {
-  lgl_frame_t   *frame;
-  GLuint         VAO;
-  GLuint         VBO;
-  lgl_vertex_t  *vertices;
-  size_t         vertex_count;
-  lgl_3f_t       position;
-  lgl_3f_t       scale;
-  lgl_4f_t       rotation;
-  GLuint         shader;
-  GLuint         diffuse_map;
-  GLuint         specular_map;
-  lgl_2f_t       texture_offset;
-  lgl_2f_t       texture_scale;
-  GLuint         lights_count;
-  lgl_light_t   *lights;
-  GLint          render_flags;
+  lgl_3f_t       min;
+  lgl_3f_t       max;
+  lgl_3f_t       center;       // bounding sphere
+  float          radius;
+} lgl_bounds_t;
+
+/*Handle to a transform in the transform store. Handles stay valid until
+  the transform is freed, 0 is never a valid handle.*/
+typedef uint32_t lgl_transform_t;
+
+/*Handle to a mesh in the registry, see lgl_mesh_upload. 0 is no mesh.*/
+typedef uint32_t lgl_mesh_t;
+
+#define LGL_MESH_NONE 0
+
+enum { LGL_TRANSFORM_NONE = 0 }; // drawn with an identity transform
+
+/*Every transform lives in one structure-of-arrays store so per-frame
+  updates walk tightly packed arrays. The arrays are indexed by a dense
+  index that changes when transforms are freed or reparented,
+  lgl_transform_index maps a stable handle to it.
+
+  Transforms form a hierarchy. A world matrix is its parent's world matrix
+  times its own local TRS, and the store is kept sorted so parents come
+  before their children. Changing a local transform marks it dirty and
+  lgl_transforms_update only recomputes dirty transforms and their
+  descendants.*/
+typedef struct {
+  size_t         count;
+  size_t         capacity;
+  lgl_3f_t      *positions;
+  lgl_4f_t      *rotations;          // unit quaternions
+  lgl_3f_t      *scales;
+  GLfloat       *models;             // world matrices, 16 floats each
+  GLfloat       *normals;            // normal matrices, 12 floats each as std140 mat3 columns
+  uint32_t      *parents;            // parent handle, LGL_TRANSFORM_NONE for roots
+  uint8_t       *dirty;              // local transform changed since lgl_transforms_update
+  uint32_t      *handles;            // dense index -> handle
+  uint32_t      *slots;              // handle - 1 -> dense index, or next free handle
+  size_t         slots_count;
+  size_t         slots_capacity;
+  uint32_t       slots_free;         // first free handle, 0 when there are none
+  size_t         dirty_first;        // lowest dense index that may be dirty
+  int            reorder;            // the hierarchy changed and must be re-sorted
+} lgl_transforms_t;
+
+#define LGL_LOD_MAX 4
+
+#ifndef LGL_LOD_HYSTERESIS
+#define LGL_LOD_HYSTERESIS 0.1f  // fraction a size must pass a threshold by to switch
+#endif // ifndef LGL_LOD_HYSTERESIS
+
+#ifndef LGL_LOD_FADE_TIME
+#define LGL_LOD_FADE_TIME 0.25f  // seconds a dithered cross-fade lasts
+#endif // ifndef LGL_LOD_FADE_TIME
+
+/*A range of an object's index buffer, or of its vertex buffer when it has
+  none, drawn while the object's bounding sphere covers at least screen_size
+  of the screen height*/
+typedef struct {
+  GLint          first;
+  GLsizei        count;
+  float          screen_size;
+} lgl_lod_t;
+
+/*Levels of detail of one object, finest first. With count 0 the whole mesh
+  is drawn. lgl_lod_select moves current between levels.*/
+typedef struct {
+  lgl_lod_t      levels[LGL_LOD_MAX];
+  uint8_t        count;
+  uint8_t        current;
+  uint8_t        previous;        // faded out while fade is below 1
+  float          fade;
+} lgl_lods_t;
+
+/*Objects with an EBO are drawn with glDrawElements from index_count 32-bit
+  indices, the rest with glDrawArrays. Packed vertex positions are fractions
+  of bounds, so bounds must stay as they were uploaded. The GL names, counts
+  and bounds are copies of mesh's, kept here so drawing never looks them up.*/
+typedef struct {
+  lgl_mesh_t      mesh;
+  GLuint          VAO;
+  GLuint          VBO;
+  GLuint          EBO;
+  size_t          vertex_count;
+  size_t          index_count;
+  GLint           vertex_format;
+  lgl_bounds_t    bounds;
+  lgl_transform_t transform;
+  lgl_lods_t      lods;
+  GLuint          shader;
+  GLuint          diffuse_map;
+  GLuint          specular_map;
+  lgl_2f_t        texture_offset;
+  lgl_2f_t        texture_scale;
+  GLint           render_flags;
 } lgl_render_data_t;
 
+/*The view every shader renders from. lgl_camera_update computes the
+  matrices and uploads them to the lgl_camera_block uniform block.*/
+typedef struct {
+  lgl_3f_t       position;
+  lgl_4f_t       rotation;        // unit quaternion
+  float          fov;             // vertical, in radians
+  float          aspect;
+  float          near;
+  float          far;
+  GLfloat        view[16];
+  GLfloat        projection[16];
+  GLfloat        view_projection[16];
+  lgl_4f_t       frustum[6];      // planes from lgl_frustum_planes
+} lgl_camera_t;
+
+/*A render data pointer and the key it is sorted by. The render data must
+  stay alive until the queue is flushed.*/
+typedef struct {
+  uint64_t                 key;
+  const lgl_render_data_t *data;
+} lgl_draw_command_t;
+
+typedef struct {
+  lgl_draw_command_t *commands;
+  lgl_draw_command_t *scratch;
+  size_t              count;
+  size_t              capacity;
+} lgl_draw_queue_t;
+
+#define LGL_STREAM_FRAMES 3
+
+#define LGL_OCCLUSION_FRAMES 3  // depth readbacks in flight
+#define LGL_OCCLUSION_LEVELS 16 // enough for a 32768 pixel wide frame
+
+#ifndef LGL_STREAM_FRAME_SIZE
+#define LGL_STREAM_FRAME_SIZE (8 << 20) // bytes of lgl's own per-frame data
+#endif // ifndef LGL_STREAM_FRAME_SIZE
+
+/*A ring buffer for data written once per frame. It is persistently mapped
+  when GL_ARB_buffer_storage is available, otherwise each push maps its
+  range unsynchronized.*/
+typedef struct {
+  GLuint         buffer;
+  size_t         frame_size;
+  size_t         frame;                     // region written this frame
+  size_t         offset;                    // write head inside the region
+  int            persistent;
+  int            in_frame;
+  int            mapped;
+  unsigned char *mapping;
+  GLsync         fences[LGL_STREAM_FRAMES];
+} lgl_stream_t;
+
+/*Where to write pushed data and the byte offset to bind the buffer at*/
+typedef struct {
+  void          *pointer;
+  GLintptr       offset;
+} lgl_stream_allocation_t;
+
+/*Layout of the commands read by glMultiDrawElementsIndirect*/
+typedef struct {
+  GLuint         count;
+  GLuint         instance_count;
+  GLuint         first_index;
+  GLint          base_vertex;
+  GLuint         base_instance;
+} lgl_draw_elements_indirect_t;
+
+/*A range of batch commands drawn with one glMultiDrawElementsIndirect call*/
+typedef struct {
+  size_t         first;
+  size_t         count;
+  GLint          vertex_format; // picks the VAO the group draws from
+} lgl_batch_group_t;
+
+/*Render data whose meshes live in one shared vertex buffer per vertex
+  format and one shared index buffer, drawn with one multi-draw call per
+  shader/texture/vertex format group. Meshes without indices get sequential
+  ones. Per-draw transforms and position dequantization are streamed each
+  frame and read by draw ID as a shader storage buffer. Each draw follows
+  its object's current level of detail but switches without a cross-fade.
+  Needs an OpenGL 4.3 context.*/
+typedef struct {
+  GLuint                        VAOs[LGL_VERTEX_FORMAT_COUNT];           // 0 for formats no object uses
+  GLuint                        vertex_buffers[LGL_VERTEX_FORMAT_COUNT];
+  GLuint                        index_buffer;
+  GLuint                        draw_id_buffer;
+  GLuint                        indirect_buffer;
+  size_t                        draw_count;
+  size_t                       *order;        // draw index -> render data index
+  GLuint                       *index_firsts; // draw index -> its mesh's first index in index_buffer
+  lgl_draw_elements_indirect_t *commands;
+  lgl_batch_group_t            *groups;
+  size_t                        groups_count;
+} lgl_batch_t;
+
+typedef struct {
+  size_t         draw_calls;            // glDraw* calls since the last reset
+  size_t         uniform_lookups;       // glGetUniformLocation calls since the last reset
+  size_t         redundant_state_calls; // GL calls skipped by the state cache, needs LGL_DEBUG_STATE
+  size_t         stream_waits;          // times the CPU waited on the GPU for a stream region
+  size_t         objects_visible;       // enabled objects inside the camera frustum
+  size_t         objects_culled;        // enabled objects skipped by frustum culling
+  size_t         objects_occluded;      // enabled objects in the frustum skipped by occlusion culling
+} lgl_stats_t;
+
+lgl_stats_t lgl_stats_get     (void);
+void        lgl_stats_reset   (void);
+
 void  lgl_viewport_set        (const float width, const float height);
 
+/*lgl skips GL calls that would not change its cached state. Call this after
+  changing bindings, stencil, blend or polygon state outside of lgl.*/
+void  lgl_state_invalidate    (void);
+
 void lgl_outline              (const size_t       data_length,
                                lgl_render_data_t *data,
                                const GLuint       outline_shader,
                                const float        thickness);
 
+lgl_bounds_t lgl_bounds_compute   (const size_t vertex_count, const lgl_vertex_t *vertices);
+
+/*Bounds in the space a model matrix transforms to. The box is the smallest
+  axis aligned box around the transformed box.*/
+lgl_bounds_t lgl_bounds_transform (const lgl_bounds_t *bounds, const GLfloat *model);
+
+lgl_camera_t lgl_camera_alloc  (void);
+void         lgl_camera_update (lgl_camera_t *camera);
+
+void  lgl_lights_upload       (const size_t lights_count, const lgl_light_t *lights);
+
+lgl_transform_t lgl_transform_alloc       (void);
+void            lgl_transform_free        (lgl_transform_t transform);
+/*SIZE_MAX for handles that were never allocated. Getters and setters log
+  those and do nothing, or return an identity transform.*/
+size_t          lgl_transform_index       (lgl_transform_t transform);
+
+/*Pass LGL_TRANSFORM_NONE to make a transform a root again*/
+void            lgl_transform_parent_set  (lgl_transform_t transform, lgl_transform_t parent);
+lgl_transform_t lgl_transform_parent      (lgl_transform_t transform);
+
+lgl_3f_t        lgl_transform_position    (lgl_transform_t transform);
+lgl_4f_t        lgl_transform_rotation    (lgl_transform_t transform);
+lgl_3f_t        lgl_transform_scale       (lgl_transform_t transform);
+void            lgl_transform_position_set(lgl_transform_t transform, const lgl_3f_t position);
+void            lgl_transform_rotation_set(lgl_transform_t transform, const lgl_4f_t rotation);
+void            lgl_transform_scale_set   (lgl_transform_t transform, const lgl_3f_t scale);
+
+/*The world matrix, valid after lgl_transforms_update*/
+const GLfloat  *lgl_transform_model       (lgl_transform_t transform);
+
+/*The store itself, for bulk updates. Call lgl_transforms_dirty with the
+  index of every transform whose local arrays were written directly.*/
+lgl_transforms_t *lgl_transforms          (void);
+void              lgl_transforms_dirty    (const size_t index);
+
+/*Rebuilds the world and normal matrices of dirty transforms and their
+  descendants. Draw calls do this on their own, call it to read matrices
+  earlier.*/
+void              lgl_transforms_update   (void);
+
+/*Uploads levels_count vertex arrays, finest first, into one vertex buffer
+  and makes them the object's levels of detail. screen_sizes are the
+  thresholds of each level, see lgl_lod_t.*/
+void  lgl_lods_buffer         (lgl_render_data_t   *data,
+                               const size_t         levels_count,
+                               lgl_vertex_t *const *vertices,
+                               const size_t        *vertex_counts,
+                               const float         *screen_sizes);
+
+/*Picks each object's level of detail from the size of its bounding sphere
+  under the active camera. Call once per frame before drawing, delta_time
+  advances running cross-fades. The instanced path draws the current level
+  without fading.*/
+void  lgl_lod_select          (const size_t       data_length,
+                               lgl_render_data_t *data,
+                               const float        delta_time);
+
 void  lgl_draw                (const size_t data_length, const lgl_render_data_t *data);
+
+/*Draws objects that share a VAO, shader, textures and render flags with one
+  instanced draw call per group. Their shader must read its per-instance
+  attributes the way phong_instanced_vertex.glsl does.*/
+void  lgl_draw_instanced      (const size_t data_length, const lgl_render_data_t *data);
 void  lgl_frame_draw          (const lgl_frame_t *frame);
+
+lgl_stream_t            lgl_stream_alloc     (const size_t frame_size);
+void                    lgl_stream_free      (lgl_stream_t *stream);
+
+/*Returns NULL in pointer when the frame's region is full. Call
+  lgl_stream_commit before issuing draws that read pushed data.*/
+lgl_stream_allocation_t lgl_stream_push      (lgl_stream_t *stream,
+                                              const size_t  size,
+                                              const size_t  alignment);
+void                    lgl_stream_commit    (lgl_stream_t *stream);
+void                    lgl_stream_end_frame (lgl_stream_t *stream);
+
+/*Starts an asynchronous readback of the frame's depth, call it once the
+  scene has been drawn. Draw calls on later frames skip objects hidden
+  behind the newest finished readback, which lags a frame or two behind, so
+  call lgl_occlusion_clear on camera cuts. Without captures nothing is
+  occlusion culled.*/
+void  lgl_occlusion_capture   (const lgl_frame_t *frame);
+void  lgl_occlusion_clear     (void);
+
+/*Fences lgl's internal per-frame buffers. Call once at the end of a frame.*/
+void  lgl_end_frame           (void);
+
+int         lgl_batch_supported (void);
+lgl_batch_t lgl_batch_alloc     (const size_t data_length, const lgl_render_data_t *data);
+void        lgl_batch_free      (lgl_batch_t *batch);
+
+/*data must be the same array the batch was allocated from. Falls back to
+  lgl_draw when multi-draw indirect is not available.*/
+void        lgl_batch_draw      (lgl_batch_t             *batch,
+                                 const size_t             data_length,
+                                 const lgl_render_data_t *data);
+
+lgl_draw_queue_t lgl_draw_queue_alloc  (const size_t capacity);
+void             lgl_draw_queue_free   (lgl_draw_queue_t *queue);
+void             lgl_draw_queue_submit (lgl_draw_queue_t        *queue,
+                                        const size_t             data_length,
+                                        const lgl_render_data_t *data);
+
+/*Submits data[indices[i]] without frustum culling, for indices that already
+  went through a visibility query such as lgl_bvh_query_frustum*/
+void             lgl_draw_queue_submit_indices (lgl_draw_queue_t        *queue,
+                                                const size_t             indices_count,
+                                                const uint32_t          *indices,
+                                                const lgl_render_data_t *data);
+void             lgl_draw_queue_flush  (lgl_draw_queue_t *queue);
 void  lgl_buffer_vertex_array (lgl_render_data_t *data);
 
 GLuint  lgl_shader_compile    (const char *file_path, GLenum type);
 GLuint  lgl_shader_link       (GLuint vertex_shader, GLuint fragment_shader);
 
 lgl_frame_t       lgl_frame_alloc (void);
+
+/*Built-in primitives are uploaded once and shared by every object made
+  from them*/
 lgl_render_data_t lgl_quad_alloc  (void);
 lgl_render_data_t lgl_cube_alloc  (void);
 
+/*Releases the object's mesh and frees its transform. Render data owns
+  both, so a plain struct copy must not be freed as well, see
+  lgl_render_data_copy.*/
+void              lgl_render_data_free (lgl_render_data_t *data);
+
+/*Another object drawing the same mesh, with a reference of its own and a
+  new transform set to data's local transform and parent*/
+lgl_render_data_t lgl_render_data_copy (const lgl_render_data_t *data);
+
+/*Uploads an indexed mesh into the registry and returns it with one
+  reference, which the caller owns. Without indices, identical vertices are
+  welded first. Triangles are reordered for the vertex cache either way.
+  vertex_format is one of LGL_VERTEX_FORMAT_*. name may be NULL, named
+  meshes can be found with lgl_mesh_find.*/
+lgl_mesh_t        lgl_mesh_upload   (const char         *name,
+                                     const size_t        vertex_count,
+                                     const lgl_vertex_t *vertices,
+                                     const size_t        index_count,
+                                     const uint32_t     *indices,
+                                     const GLint         vertex_format);
+
+/*A mesh's GL buffers are deleted when its last reference is released*/
+void              lgl_mesh_acquire  (lgl_mesh_t mesh);
+void              lgl_mesh_release  (lgl_mesh_t mesh);
+
+/*The named mesh, or LGL_MESH_NONE. Does not add a reference.*/
+lgl_mesh_t        lgl_mesh_find     (const char *name);
+
+/*Render data drawing mesh with a new transform. Holds a reference to mesh
+  until lgl_render_data_free.*/
+lgl_render_data_t lgl_mesh_instance (lgl_mesh_t mesh);
+
+/*lgl_mesh_upload and lgl_mesh_instance of an unnamed mesh*/
+lgl_render_data_t lgl_mesh_alloc    (const size_t        vertex_count,
+                                     const lgl_vertex_t *vertices,
+                                     const size_t        index_count,
+                                     const uint32_t     *indices,
+                                     const GLint         vertex_format);
+
+/*Loads the meshes of an .lmod file, see lgl_lmod.h, and writes an object
+  for each to data, at most data_capacity. Returns how many it wrote, 0 on
+  errors. The file is memory mapped and parsed in one pass, and indices and
+  levels of detail are uploaded as listed, so run tools/lmod_optimize on
+  models first. Meshes are registered as "<path>:<mesh name>", and loading
+  a file again shares the meshes already registered, in the vertex format
+  they were first loaded with.*/
+size_t            lgl_lmod_alloc    (const char        *path,
+                                     const GLint        vertex_format,
+                                     const size_t       data_capacity,
+                                     lgl_render_data_t *data);
+
+#ifndef LGL_LMODB_VERIFY
+#define LGL_LMODB_VERIFY 1 // lgl_lmodb_alloc checks hashes and indices, one read of the file
+#endif // ifndef LGL_LMODB_VERIFY
+
+/*Loads a compiled .lmodb file, see lgl_lmod.h and tools/lmod_compile, like
+  lgl_lmod_alloc. Sections are uploaded straight from the mapped file.
+  Meshes are registered by the file's hash and their names, loading the
+  same content again shares them.*/
+size_t            lgl_lmodb_alloc   (const char        *path,
+                                     const size_t       data_capacity,
+                                     lgl_render_data_t *data);
+
 void lgl_perspective          (float *mat,
                                const float fov,
                                const float aspect,
                                const float near,
                                const float far);
 
+/*Loads any image stb_image reads, or a .ktx file baked by
+  tools/texture_bake, whose levels are uploaded as stored, block compressed
+  when the driver supports the format and decoded to RGBA8 otherwise*/
 GLuint lgl_texture_alloc(const char *imageFile);
 
+#ifndef LGL_PIXEL_BUFFERS
+#define LGL_PIXEL_BUFFERS 4 // pixel unpack buffers texture uploads rotate through
+#endif // ifndef LGL_PIXEL_BUFFERS
+
+/*Maps size bytes of the next pixel unpack buffer for writing, waiting only
+  if the GPU still reads from it. Write or decode tightly packed RGB or RGBA
+  rows into it, then hand them to lgl_texture_image or lgl_texture_update,
+  which return right away while the GPU copies from the buffer. One mapping
+  at a time. Returns NULL on failure.*/
+void  *lgl_pixels_map         (const size_t size);
+
+/*Replaces texture's image with the mapped pixels and builds its mipmaps*/
+void   lgl_texture_image      (const GLuint texture,
+                               const int    width,
+                               const int    height,
+                               const int    channels);
+
+/*Overwrites a rectangle of texture's base level with the mapped pixels.
+  For textures changing at runtime, mipmaps are left as they were.*/
+void   lgl_texture_update     (const GLuint texture,
+                               const int    x,
+                               const int    y,
+                               const int    width,
+                               const int    height,
+                               const int    channels);
+
+void   lgl_pixel_buffers_free (void);
+
+#ifndef LGL_TEXTURE_THREADS
+#define LGL_TEXTURE_THREADS 4 // workers reading and decoding lgl_texture_alloc_async files
+#endif // ifndef LGL_TEXTURE_THREADS
+
+/*Returns a texture right away that holds one grey texel until its file
+  has been read and decoded on a worker thread and uploaded by
+  lgl_texture_uploads_process. It can be drawn with meanwhile.*/
+GLuint lgl_texture_alloc_async(const char *path);
+
+/*Uploads decoded textures until budget seconds have passed, at least one
+  if any is ready. Call once per frame on the GL thread. Returns how many
+  textures are still loading.*/
+size_t lgl_texture_uploads_process(const float budget);
+
+/*Stops the worker threads. Textures still loading keep their placeholder.*/
+void   lgl_texture_loader_free(void);
+
 static inline lgl_2f_t lgl_2f_zero   (void)    { return (lgl_2f_t) {  0.0f,  0.0f}; }
 static inline lgl_2f_t lgl_2f_one    (float s) { return (lgl_2f_t) {  s,     s   }; }
 static inline lgl_2f_t lgl_2f_up     (float s) { return (lgl_2f_t) {  0.0f,  s   }; }
@@ -0,0 +1,507 @@
+#include "lgl_bvh.h"
+
+#include <float.h>
+#include <pthread.h>
+
+enum {
+  LGL__BVH_BINS      = 12,
+  LGL__BVH_LEAF_MIN  = 2,   // ranges this small are never split
+  LGL__BVH_LEAF_MAX  = 8,   // ranges this large are always split
+  LGL__BVH_SAH_DEPTH = 64,  // deeper than this, ranges are split at the median
+  LGL__BVH_STACK     = 96,
+};
+
+#define LGL__BVH_NONE      UINT32_MAX
+#define LGL__BVH_UNBOUNDED 1e15f // half size of the box given to unknown bounds
+
+static inline float lgl__bvh_area(const lgl_3f_t min, const lgl_3f_t max) {
+  const float x = max.x - min.x, y = max.y - min.y, z = max.z - min.z;
+  return x * y + y * z + z * x;
+}
+
+static inline void lgl__bvh_grow(lgl_3f_t *min, lgl_3f_t *max, const lgl_3f_t box_min, const lgl_3f_t box_max) {
+  min->x = fminf(min->x, box_min.x); max->x = fmaxf(max->x, box_max.x);
+  min->y = fminf(min->y, box_min.y); max->y = fmaxf(max->y, box_max.y);
+  min->z = fminf(min->z, box_min.z); max->z = fmaxf(max->z, box_max.z);
+}
+
+static inline float lgl__bvh_axis(const lgl_3f_t v, const int axis) {
+  return axis == 0 ? v.x : axis == 1 ? v.y : v.z;
+}
+
+static void lgl__bvh_object_box(const lgl_render_data_t *data, lgl_3f_t *min, lgl_3f_t *max) {
+  if (data->bounds.radius <= 0) {
+    *min = lgl_3f_one(-LGL__BVH_UNBOUNDED);
+    *max = lgl_3f_one( LGL__BVH_UNBOUNDED);
+    return;
+  }
+
+  const lgl_bounds_t world = lgl_bounds_transform(&data->bounds, lgl_transform_model(data->transform));
+  *min = world.min;
+  *max = world.max;
+}
+
+/*-- build -----------------------------------------------------------------*/
+
+/*A subtree to build. Its root goes in node and its descendants fill the
+  nodes from children on, 2 * count - 2 at most, so subtrees built on
+  different threads never touch the same nodes.*/
+typedef struct {
+  lgl_bvh_t      *bvh;
+  const lgl_3f_t *centroids;
+  uint32_t        node;
+  uint32_t        parent;
+  uint32_t        children;
+  uint32_t        first;
+  uint32_t        count;
+  uint32_t        depth;
+  uint32_t        threads;
+} lgl__bvh_task_t;
+
+static void lgl__bvh_build(lgl__bvh_task_t task);
+
+static void *lgl__bvh_build_thread(void *task) {
+  lgl__bvh_build(*(lgl__bvh_task_t*)task);
+  return NULL;
+}
+
+/*Picks a split with the surface area heuristic over binned centroids.
+  Returns the size of the left range after partitioning, or 0 when a leaf is
+  cheaper.*/
+static uint32_t lgl__bvh_split_sah(
+    lgl__bvh_task_t task,
+    const lgl_3f_t  centroid_min,
+    const lgl_3f_t  centroid_max,
+    const float     area) {
+  lgl_bvh_t *bvh        = task.bvh;
+  uint32_t  *primitives = &bvh->primitives[task.first];
+
+  float best_cost  = task.count; // the cost of a leaf, in primitive tests
+  int   best_axis  = -1;
+  int   best_split = 0;
+
+  for(int axis = 0; axis < 3; axis++) {
+    const float low    = lgl__bvh_axis(centroid_min, axis);
+    const float extent = lgl__bvh_axis(centroid_max, axis) - low;
+    if (extent <= 0) {
+      continue;
+    }
+
+    struct {
+      lgl_3f_t min, max;
+      uint32_t count;
+    } bins[LGL__BVH_BINS];
+
+    for(int i = 0; i < LGL__BVH_BINS; i++) {
+      bins[i].min   = lgl_3f_one( FLT_MAX);
+      bins[i].max   = lgl_3f_one(-FLT_MAX);
+      bins[i].count = 0;
+    }
+
+    const float scale = LGL__BVH_BINS / extent;
+    for(uint32_t i = 0; i < task.count; i++) {
+      const uint32_t p = primitives[i];
+      int bin = (lgl__bvh_axis(task.centroids[p], axis) - low) * scale;
+      if (bin >= LGL__BVH_BINS) { bin = LGL__BVH_BINS - 1; }
+      bins[bin].count++;
+      lgl__bvh_grow(&bins[bin].min, &bins[bin].max, bvh->mins[p], bvh->maxs[p]);
+    }
+
+    // sweep from the right to get the cost of every right side, then from
+    // the left to evaluate each split
+    float    right_area [LGL__BVH_BINS];
+    uint32_t right_count[LGL__BVH_BINS];
+    {
+      lgl_3f_t min = lgl_3f_one(FLT_MAX), max = lgl_3f_one(-FLT_MAX);
+      uint32_t count = 0;
+      for(int i = LGL__BVH_BINS - 1; i > 0; i--) {
+        count += bins[i].count;
+        lgl__bvh_grow(&min, &max, bins[i].min, bins[i].max);
+        right_area [i] = count ? lgl__bvh_area(min, max) : 0;
+        right_count[i] = count;
+      }
+    }
+
+    lgl_3f_t min = lgl_3f_one(FLT_MAX), max = lgl_3f_one(-FLT_MAX);
+    uint32_t count = 0;
+    for(int i = 0; i < LGL__BVH_BINS - 1; i++) {
+      count += bins[i].count;
+      lgl__bvh_grow(&min, &max, bins[i].min, bins[i].max);
+      if (count == 0 || right_count[i + 1] == 0) {
+        continue;
+      }
+
+      const float cost = 1.0f +
+        (lgl__bvh_area(min, max) * count + right_area[i + 1] * right_count[i + 1]) / area;
+      if (cost < best_cost) {
+        best_cost  = cost;
+        best_axis  = axis;
+        best_split = i + 1;
+      }
+    }
+  }
+
+  if (best_axis < 0) {
+    return 0;
+  }
+
+  const float low   = lgl__bvh_axis(centroid_min, best_axis);
+  const float scale = LGL__BVH_BINS / (lgl__bvh_axis(centroid_max, best_axis) - low);
+
+  uint32_t left = 0, right = task.count;
+  while (left < right) {
+    int bin = (lgl__bvh_axis(task.centroids[primitives[left]], best_axis) - low) * scale;
+    if (bin >= LGL__BVH_BINS) { bin = LGL__BVH_BINS - 1; }
+
+    if (bin < best_split) {
+      left++;
+    } else {
+      const uint32_t swap = primitives[left];
+      primitives[left]    = primitives[--right];
+      primitives[right]   = swap;
+    }
+  }
+
+  return left;
+}
+
+static void lgl__bvh_build(lgl__bvh_task_t task) {
+  lgl_bvh_t      *bvh  = task.bvh;
+  lgl_bvh_node_t *node = &bvh->nodes[task.node];
+
+  lgl_3f_t min          = lgl_3f_one( FLT_MAX), max          = lgl_3f_one(-FLT_MAX);
+  lgl_3f_t centroid_min = lgl_3f_one( FLT_MAX), centroid_max = lgl_3f_one(-FLT_MAX);
+  for(uint32_t i = task.first; i < task.first + task.count; i++) {
+    const uint32_t p = bvh->primitives[i];
+    lgl__bvh_grow(&min, &max, bvh->mins[p], bvh->maxs[p]);
+    lgl__bvh_grow(&centroid_min, &centroid_max, task.centroids[p], task.centroids[p]);
+  }
+
+  *node = (lgl_bvh_node_t) {
+    .min    = min,
+    .max    = max,
+    .first  = task.first,
+    .count  = task.count,
+    .child  = 0,
+    .parent = task.parent,
+  };
+
+  uint32_t left_count = 0;
+  if (task.count > LGL__BVH_LEAF_MIN) {
+    if (task.depth < LGL__BVH_SAH_DEPTH) {
+      left_count = lgl__bvh_split_sah(task, centroid_min, centroid_max, lgl__bvh_area(min, max));
+    }
+    if (left_count == 0 && task.count > LGL__BVH_LEAF_MAX) {
+      left_count = task.count / 2; // no useful split, any halving will do
+    }
+  }
+
+  if (left_count == 0) {
+    for(uint32_t i = task.first; i < task.first + task.count; i++) {
+      bvh->leaves[bvh->primitives[i]] = task.node;
+    }
+    return;
+  }
+
+  node->child = task.children;
+
+  lgl__bvh_task_t left = task, right = task;
+  left.node      = task.children;
+  left.parent    = task.node;
+  left.children  = task.children + 2;
+  left.count     = left_count;
+  left.depth     = task.depth + 1;
+  left.threads   = task.threads / 2;
+
+  right.node     = task.children + 1;
+  right.parent   = task.node;
+  right.children = left.children + 2 * left_count - 2;
+  right.first    = task.first + left_count;
+  right.count    = task.count - left_count;
+  right.depth    = task.depth + 1;
+  right.threads  = task.threads - left.threads;
+
+  if (task.threads > 1 && task.count >= LGL_BVH_PARALLEL_MIN) {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, lgl__bvh_build_thread, &left) == 0) {
+      lgl__bvh_build(right);
+      pthread_join(thread, NULL);
+      return;
+    }
+  }
+
+  lgl__bvh_build(left);
+  lgl__bvh_build(right);
+}
+
+lgl_bvh_t lgl_bvh_alloc(const size_t data_length, const lgl_render_data_t *data) {
+  lgl_bvh_t bvh = {0};
+  if (data_length == 0) {
+    return bvh;
+  }
+
+  bvh.count          = data_length;
+  bvh.nodes_capacity = 2 * data_length - 1;
+  bvh.nodes          = calloc(bvh.nodes_capacity, sizeof(*bvh.nodes));
+  bvh.primitives     = calloc(data_length, sizeof(*bvh.primitives));
+  bvh.leaves         = calloc(data_length, sizeof(*bvh.leaves));
+  bvh.mins           = calloc(data_length, sizeof(*bvh.mins));
+  bvh.maxs           = calloc(data_length, sizeof(*bvh.maxs));
+
+  lgl_3f_t *centroids = calloc(data_length, sizeof(*centroids));
+
+  for(size_t i = 0; i < data_length; i++) {
+    lgl__bvh_object_box(&data[i], &bvh.mins[i], &bvh.maxs[i]);
+    centroids[i] = (lgl_3f_t) {
+      (bvh.mins[i].x + bvh.maxs[i].x) * 0.5f,
+      (bvh.mins[i].y + bvh.maxs[i].y) * 0.5f,
+      (bvh.mins[i].z + bvh.maxs[i].z) * 0.5f,
+    };
+    bvh.primitives[i] = i;
+  }
+
+  lgl__bvh_build((lgl__bvh_task_t) {
+    .bvh       = &bvh,
+    .centroids = centroids,
+    .node      = 0,
+    .parent    = LGL__BVH_NONE,
+    .children  = 1,
+    .first     = 0,
+    .count     = data_length,
+    .depth     = 0,
+    .threads   = LGL_BVH_THREADS,
+  });
+
+  free(centroids);
+  return bvh;
+}
+
+void lgl_bvh_free(lgl_bvh_t *bvh) {
+  free(bvh->nodes);
+  free(bvh->primitives);
+  free(bvh->leaves);
+  free(bvh->mins);
+  free(bvh->maxs);
+  *bvh = (lgl_bvh_t){0};
+}
+
+/*-- refit -----------------------------------------------------------------*/
+
+void lgl_bvh_refit(
+    lgl_bvh_t               *bvh,
+    const size_t             changed_count,
+    const uint32_t          *changed,
+    const lgl_render_data_t *data) {
+
+  for(size_t i = 0; i < changed_count; i++) {
+    const uint32_t object = changed[i];
+    lgl__bvh_object_box(&data[object], &bvh->mins[object], &bvh->maxs[object]);
+
+    // walk up until a box stops changing
+    for(uint32_t n = bvh->leaves[object]; n != LGL__BVH_NONE;) {
+      lgl_bvh_node_t *node = &bvh->nodes[n];
+
+      lgl_3f_t min = lgl_3f_one(FLT_MAX), max = lgl_3f_one(-FLT_MAX);
+      if (node->child) {
+        const lgl_bvh_node_t *a = &bvh->nodes[node->child];
+        const lgl_bvh_node_t *b = &bvh->nodes[node->child + 1];
+        lgl__bvh_grow(&min, &max, a->min, a->max);
+        lgl__bvh_grow(&min, &max, b->min, b->max);
+      } else {
+        for(uint32_t j = node->first; j < node->first + node->count; j++) {
+          const uint32_t p = bvh->primitives[j];
+          lgl__bvh_grow(&min, &max, bvh->mins[p], bvh->maxs[p]);
+        }
+      }
+
+      if (memcmp(&min, &node->min, sizeof(min)) == 0 &&
+          memcmp(&max, &node->max, sizeof(max)) == 0) {
+        break;
+      }
+
+      node->min = min;
+      node->max = max;
+      n = node->parent;
+    }
+  }
+}
+
+/*-- queries ---------------------------------------------------------------*/
+
+enum {
+  LGL__BVH_OUTSIDE,
+  LGL__BVH_INTERSECTING,
+  LGL__BVH_INSIDE,
+};
+
+static inline int lgl__bvh_frustum_test(const lgl_4f_t *planes, const lgl_3f_t min, const lgl_3f_t max) {
+  int result = LGL__BVH_INSIDE;
+  for(size_t i = 0; i < 6; i++) {
+    const lgl_4f_t p = planes[i];
+
+    // the corners furthest along and against the plane normal
+    const lgl_3f_t
+      positive = { p.x >= 0 ? max.x : min.x, p.y >= 0 ? max.y : min.y, p.z >= 0 ? max.z : min.z },
+      negative = { p.x >= 0 ? min.x : max.x, p.y >= 0 ? min.y : max.y, p.z >= 0 ? min.z : max.z };
+
+    if (p.x * positive.x + p.y * positive.y + p.z * positive.z + p.w < 0) {
+      return LGL__BVH_OUTSIDE;
+    }
+    if (p.x * negative.x + p.y * negative.y + p.z * negative.z + p.w < 0) {
+      result = LGL__BVH_INTERSECTING;
+    }
+  }
+  return result;
+}
+
+size_t lgl_bvh_query_frustum(
+    const lgl_bvh_t *bvh,
+    const lgl_4f_t  *planes,
+    uint32_t        *results,
+    const size_t     capacity) {
+  if (bvh->count == 0) {
+    return 0;
+  }
+
+  size_t   written = 0;
+  uint32_t stack[LGL__BVH_STACK];
+  size_t   top = 0;
+  stack[top++] = 0;
+
+  while (top > 0 && written < capacity) {
+    const lgl_bvh_node_t *node = &bvh->nodes[stack[--top]];
+
+    const int test = lgl__bvh_frustum_test(planes, node->min, node->max);
+    if (test == LGL__BVH_OUTSIDE) {
+      continue;
+    }
+
+    // a subtree fully inside needs no more tests
+    if (test == LGL__BVH_INSIDE) {
+      for(uint32_t i = node->first; i < node->first + node->count && written < capacity; i++) {
+        results[written++] = bvh->primitives[i];
+      }
+      continue;
+    }
+
+    if (node->child) {
+      stack[top++] = node->child + 1;
+      stack[top++] = node->child;
+      continue;
+    }
+
+    for(uint32_t i = node->first; i < node->first + node->count && written < capacity; i++) {
+      const uint32_t p = bvh->primitives[i];
+      if (lgl__bvh_frustum_test(planes, bvh->mins[p], bvh->maxs[p]) != LGL__BVH_OUTSIDE) {
+        results[written++] = p;
+      }
+    }
+  }
+
+  return written;
+}
+
+static inline int lgl__bvh_overlaps(
+    const lgl_3f_t a_min, const lgl_3f_t a_max,
+    const lgl_3f_t b_min, const lgl_3f_t b_max) {
+  return
+    a_min.x <= b_max.x && a_max.x >= b_min.x &&
+    a_min.y <= b_max.y && a_max.y >= b_min.y &&
+    a_min.z <= b_max.z && a_max.z >= b_min.z;
+}
+
+size_t lgl_bvh_query_aabb(
+    const lgl_bvh_t *bvh,
+    const lgl_3f_t   min,
+    const lgl_3f_t   max,
+    uint32_t        *results,
+    const size_t     capacity) {
+  if (bvh->count == 0) {
+    return 0;
+  }
+
+  size_t   written = 0;
+  uint32_t stack[LGL__BVH_STACK];
+  size_t   top = 0;
+  stack[top++] = 0;
+
+  while (top > 0 && written < capacity) {
+    const lgl_bvh_node_t *node = &bvh->nodes[stack[--top]];
+    if (!lgl__bvh_overlaps(min, max, node->min, node->max)) {
+      continue;
+    }
+
+    if (node->child) {
+      stack[top++] = node->child + 1;
+      stack[top++] = node->child;
+      continue;
+    }
+
+    for(uint32_t i = node->first; i < node->first + node->count && written < capacity; i++) {
+      const uint32_t p = bvh->primitives[i];
+      if (lgl__bvh_overlaps(min, max, bvh->mins[p], bvh->maxs[p])) {
+        results[written++] = p;
+      }
+    }
+  }
+
+  return written;
+}
+
+/*Slab test against the ray's inverse direction*/
+static inline int lgl__bvh_ray_hits(
+    const lgl_3f_t origin,
+    const lgl_3f_t inverse,
+    const float    max_distance,
+    const lgl_3f_t min,
+    const lgl_3f_t max) {
+  const float
+    x0 = (min.x - origin.x) * inverse.x, x1 = (max.x - origin.x) * inverse.x,
+    y0 = (min.y - origin.y) * inverse.y, y1 = (max.y - origin.y) * inverse.y,
+    z0 = (min.z - origin.z) * inverse.z, z1 = (max.z - origin.z) * inverse.z;
+
+  const float near = fmaxf(fmaxf(fminf(x0, x1), fminf(y0, y1)), fmaxf(fminf(z0, z1), 0.0f));
+  const float far  = fminf(fminf(fmaxf(x0, x1), fmaxf(y0, y1)), fminf(fmaxf(z0, z1), max_distance));
+  return near <= far;
+}
+
+size_t lgl_bvh_query_ray(
+    const lgl_bvh_t *bvh,
+    const lgl_3f_t   origin,
+    const lgl_3f_t   direction,
+    const float      max_distance,
+    uint32_t        *results,
+    const size_t     capacity) {
+  if (bvh->count == 0) {
+    return 0;
+  }
+
+  const lgl_3f_t inverse = { 1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z };
+
+  size_t   written = 0;
+  uint32_t stack[LGL__BVH_STACK];
+  size_t   top = 0;
+  stack[top++] = 0;
+
+  while (top > 0 && written < capacity) {
+    const lgl_bvh_node_t *node = &bvh->nodes[stack[--top]];
+    if (!lgl__bvh_ray_hits(origin, inverse, max_distance, node->min, node->max)) {
+      continue;
+    }
+
+    if (node->child) {
+      stack[top++] = node->child + 1;
+      stack[top++] = node->child;
+      continue;
+    }
+
+    for(uint32_t i = node->first; i < node->first + node->count && written < capacity; i++) {
+      const uint32_t p = bvh->primitives[i];
+      if (lgl__bvh_ray_hits(origin, inverse, max_distance, bvh->mins[p], bvh->maxs[p])) {
+        results[written++] = p;
+      }
+    }
+  }
+
+  return written;
+}
@@ -0,0 +1,88 @@
+/*--------------------------------------------------------------------------/
+/                                                                           /
+/ lgl_bvh.h                                                                 /
+/ Bounding volume hierarchy over render data                                /
+/                                                                           /
+/--------------------------------------------------------------------------*/
+
+#ifndef LGL_BVH_H
+#define LGL_BVH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif // ifdef __cplusplus
+
+#include "lgl.h"
+
+#ifndef LGL_BVH_THREADS
+#define LGL_BVH_THREADS 4        // threads a build may use, 1 builds serially
+#endif // ifndef LGL_BVH_THREADS
+
+#ifndef LGL_BVH_PARALLEL_MIN
+#define LGL_BVH_PARALLEL_MIN 4096 // smallest subtree handed to another thread
+#endif // ifndef LGL_BVH_PARALLEL_MIN
+
+/*A node covers a contiguous range of the primitive array. Inner nodes have
+  their two children at child and child + 1, leaves have child 0.*/
+typedef struct {
+  lgl_3f_t       min;
+  uint32_t       first;        // first primitive of the subtree
+  lgl_3f_t       max;
+  uint32_t       count;        // primitives in the subtree
+  uint32_t       child;
+  uint32_t       parent;
+} lgl_bvh_node_t;
+
+/*Built over an lgl_render_data_t array. Primitives are indices into that
+  array, and queries write those indices.*/
+typedef struct {
+  lgl_bvh_node_t *nodes;
+  size_t          nodes_capacity;
+  uint32_t       *primitives;  // render data indices, in leaf order
+  uint32_t       *leaves;      // render data index -> leaf node
+  lgl_3f_t       *mins;        // world AABB per render data index
+  lgl_3f_t       *maxs;
+  size_t          count;
+} lgl_bvh_t;
+
+/*Builds with binned SAH, in parallel when the tree is large enough. Objects
+  with unknown bounds get a box that every query hits. Transforms must be up
+  to date, see lgl_transforms_update.*/
+lgl_bvh_t lgl_bvh_alloc (const size_t data_length, const lgl_render_data_t *data);
+void      lgl_bvh_free  (lgl_bvh_t *bvh);
+
+/*Refits the boxes of the objects at changed[0..changed_count) and of their
+  ancestors after those objects moved. Fine for dynamic objects as long as
+  they stay near where the tree was built, rebuild otherwise.*/
+void      lgl_bvh_refit (lgl_bvh_t               *bvh,
+                         const size_t             changed_count,
+                         const uint32_t          *changed,
+                         const lgl_render_data_t *data);
+
+/*Queries write at most capacity render data indices into results and
+  return how many were written. None of them allocate.*/
+size_t    lgl_bvh_query_frustum (const lgl_bvh_t *bvh,
+                                 const lgl_4f_t  *planes,
+                                 uint32_t        *results,
+                                 const size_t     capacity);
+
+size_t    lgl_bvh_query_aabb    (const lgl_bvh_t *bvh,
+                                 const lgl_3f_t   min,
+                                 const lgl_3f_t   max,
+                                 uint32_t        *results,
+                                 const size_t     capacity);
+
+/*Objects whose box the ray hits within max_distance, in no particular
+  order*/
+size_t    lgl_bvh_query_ray     (const lgl_bvh_t *bvh,
+                                 const lgl_3f_t   origin,
+                                 const lgl_3f_t   direction,
+                                 const float      max_distance,
+                                 uint32_t        *results,
+                                 const size_t     capacity);
+
+#ifdef __cplusplus
+}
+#endif // ifdef __cplusplus
+
+#endif // LGL_BVH_H
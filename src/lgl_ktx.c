@@ -0,0 +1,654 @@
+#include "lgl_ktx.h"
+
+/*-- blocks ----------------------------------------------------------------*/
+
+/*Copies the 4x4 block at block column bx and row by, repeating the last
+  row and column of images whose sides are not a multiple of 4*/
+static void lgl__ktx_block_read(
+    const uint32_t width,
+    const uint32_t height,
+    const uint8_t *rgba,
+    const uint32_t bx,
+    const uint32_t by,
+    uint8_t        texels[16][4]) {
+  for(uint32_t y = 0; y < 4; y++) {
+    const uint32_t row = by * 4 + y < height ? by * 4 + y : height - 1;
+    for(uint32_t x = 0; x < 4; x++) {
+      const uint32_t column = bx * 4 + x < width ? bx * 4 + x : width - 1;
+      memcpy(texels[y * 4 + x], &rgba[((size_t)row * width + column) * 4], 4);
+    }
+  }
+}
+
+/*Stores the part of a decoded block that is inside the image*/
+static void lgl__ktx_block_write(
+    const uint32_t width,
+    const uint32_t height,
+    uint8_t       *rgba,
+    const uint32_t bx,
+    const uint32_t by,
+    uint8_t        texels[16][4]) {
+  for(uint32_t y = 0; y < 4 && by * 4 + y < height; y++) {
+    for(uint32_t x = 0; x < 4 && bx * 4 + x < width; x++) {
+      memcpy(&rgba[((size_t)(by * 4 + y) * width + bx * 4 + x) * 4], texels[y * 4 + x], 4);
+    }
+  }
+}
+
+/*Finds the line through the block's texels that the endpoints of every
+  BC format sit on: the texels' principal axis, by power iteration on their
+  covariance, cut where the outermost texels project onto it. channels is 3
+  to fit colour only.*/
+static void lgl__ktx_line_fit(
+    uint8_t   texels[16][4],
+    const int channels,
+    float     start[4],
+    float     end[4]) {
+  float mean[4] = {0};
+  for(int i = 0; i < 16; i++) {
+    for(int c = 0; c < channels; c++) {
+      mean[c] += texels[i][c] / 16.0f;
+    }
+  }
+
+  float covariance[4][4] = {{0}};
+  for(int i = 0; i < 16; i++) {
+    for(int a = 0; a < channels; a++) {
+      for(int b = 0; b < channels; b++) {
+        covariance[a][b] += (texels[i][a] - mean[a]) * (texels[i][b] - mean[b]);
+      }
+    }
+  }
+
+  // seed from the covariance column of the channel that varies most. a fixed
+  // seed such as the gray axis can be orthogonal to the principal axis, a red
+  // to green edge has no gray in it, and the iteration would die on the
+  // first step. this column is only zero when every texel is the same.
+  int widest = 0;
+  for(int c = 1; c < channels; c++) {
+    if (covariance[c][c] > covariance[widest][widest]) {
+      widest = c;
+    }
+  }
+
+  float axis[4] = {0};
+  for(int c = 0; c < channels; c++) {
+    axis[c] = covariance[c][widest];
+  }
+
+  for(int iteration = 0; iteration < 8 && covariance[widest][widest] > 0.0f; iteration++) {
+    float next[4] = {0}, largest = 0.0f;
+    for(int a = 0; a < channels; a++) {
+      for(int b = 0; b < channels; b++) {
+        next[a] += covariance[a][b] * axis[b];
+      }
+      largest = fmaxf(largest, fabsf(next[a]));
+    }
+    if (largest == 0.0f) {
+      break;
+    }
+    for(int c = 0; c < channels; c++) {
+      axis[c] = next[c] / largest;
+    }
+  }
+
+  float lowest = INFINITY, highest = -INFINITY, length = 0.0f;
+  for(int c = 0; c < channels; c++) {
+    length += axis[c] * axis[c];
+  }
+  for(int i = 0; i < 16; i++) {
+    float t = 0.0f;
+    for(int c = 0; c < channels; c++) {
+      t += (texels[i][c] - mean[c]) * axis[c];
+    }
+    lowest  = fminf(lowest,  t);
+    highest = fmaxf(highest, t);
+  }
+
+  for(int c = 0; c < 4; c++) {
+    const float direction = c < channels && length > 0.0f ? axis[c] / length : 0.0f;
+    start[c] = fminf(fmaxf(mean[c] + direction * lowest,  0.0f), 255.0f);
+    end[c]   = fminf(fmaxf(mean[c] + direction * highest, 0.0f), 255.0f);
+  }
+}
+
+/*Picks the palette entry nearest each texel. Returns the squared error.*/
+static uint32_t lgl__ktx_indices(
+    uint8_t        texels[16][4],
+    const int      channels,
+    const int      palette_count,
+    uint8_t        palette[][4],
+    uint8_t        indices[16]) {
+  uint32_t error = 0;
+  for(int i = 0; i < 16; i++) {
+    uint32_t best = UINT32_MAX;
+    for(int p = 0; p < palette_count; p++) {
+      uint32_t distance = 0;
+      for(int c = 0; c < channels; c++) {
+        const int d = (int)texels[i][c] - palette[p][c];
+        distance += d * d;
+      }
+      if (distance < best) {
+        best       = distance;
+        indices[i] = p;
+      }
+    }
+    error += best;
+  }
+  return error;
+}
+
+/*-- BC1 and BC3 -----------------------------------------------------------*/
+
+static inline uint16_t lgl__ktx_565(const float color[4]) {
+  const int r = (int)(color[0] * 31.0f / 255.0f + 0.5f);
+  const int g = (int)(color[1] * 63.0f / 255.0f + 0.5f);
+  const int b = (int)(color[2] * 31.0f / 255.0f + 0.5f);
+  return r << 11 | g << 5 | b;
+}
+
+static inline void lgl__ktx_565_expand(const uint16_t color, uint8_t rgba[4]) {
+  const int r = color >> 11, g = (color >> 5) & 63, b = color & 31;
+  rgba[0] = r << 3 | r >> 2;
+  rgba[1] = g << 2 | g >> 4;
+  rgba[2] = b << 3 | b >> 2;
+  rgba[3] = 255;
+}
+
+/*The four colours of a block, or three and transparent black when the
+  first endpoint is not the larger and four_colors is not set*/
+static void lgl__ktx_color_palette(
+    const uint16_t color0,
+    const uint16_t color1,
+    const int      four_colors,
+    uint8_t        palette[4][4]) {
+  lgl__ktx_565_expand(color0, palette[0]);
+  lgl__ktx_565_expand(color1, palette[1]);
+  for(int c = 0; c < 3; c++) {
+    if (four_colors || color0 > color1) {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    } else {
+      palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+      palette[3][c] = 0;
+    }
+  }
+  palette[2][3] = 255;
+  palette[3][3] = four_colors || color0 > color1 ? 255 : 0;
+}
+
+/*Quantizes the endpoints, largest first so the block is in four colour
+  mode, and indexes the texels against them. Returns the squared error.*/
+static uint32_t lgl__ktx_color_try(
+    uint8_t      texels[16][4],
+    const float  start[4],
+    const float  end[4],
+    uint16_t    *color0,
+    uint16_t    *color1,
+    uint8_t      indices[16]) {
+  uint16_t a = lgl__ktx_565(end), b = lgl__ktx_565(start);
+  if (a < b) {
+    const uint16_t swap = a;
+    a = b;
+    b = swap;
+  }
+  *color0 = a;
+  *color1 = b;
+
+  if (a == b) {
+    uint8_t palette[1][4];
+    lgl__ktx_565_expand(a, palette[0]);
+    return lgl__ktx_indices(texels, 3, 1, palette, indices);
+  }
+
+  uint8_t palette[4][4];
+  lgl__ktx_color_palette(a, b, 1, palette);
+  return lgl__ktx_indices(texels, 3, 4, palette, indices);
+}
+
+/*Encodes the colour half of a BC1 or BC3 block. The endpoints from the
+  line fit are refined once by least squares against the indices they
+  gave, which is kept if it is closer.*/
+static void lgl__ktx_color_encode(uint8_t texels[16][4], uint8_t block[8]) {
+  float start[4], end[4];
+  lgl__ktx_line_fit(texels, 3, start, end);
+
+  uint16_t color0, color1;
+  uint8_t  indices[16];
+  uint32_t error = lgl__ktx_color_try(texels, start, end, &color0, &color1, indices);
+
+  static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f }; // of color0
+  float aa = 0.0f, ab = 0.0f, bb = 0.0f, ax[3] = {0}, bx[3] = {0};
+  for(int i = 0; i < 16; i++) {
+    const float w = weights[indices[i]];
+    aa += w * w;
+    ab += w * (1.0f - w);
+    bb += (1.0f - w) * (1.0f - w);
+    for(int c = 0; c < 3; c++) {
+      ax[c] += w * texels[i][c];
+      bx[c] += (1.0f - w) * texels[i][c];
+    }
+  }
+
+  const float determinant = aa * bb - ab * ab;
+  if (color0 != color1 && fabsf(determinant) > 1e-6f) {
+    float refined_end[4] = {0}, refined_start[4] = {0};
+    for(int c = 0; c < 3; c++) {
+      refined_end[c]   = fminf(fmaxf((ax[c] * bb - bx[c] * ab) / determinant, 0.0f), 255.0f);
+      refined_start[c] = fminf(fmaxf((bx[c] * aa - ax[c] * ab) / determinant, 0.0f), 255.0f);
+    }
+
+    uint16_t refined0, refined1;
+    uint8_t  refined_indices[16];
+    const uint32_t refined_error = lgl__ktx_color_try(texels, refined_start, refined_end,
+        &refined0, &refined1, refined_indices);
+    if (refined_error < error) {
+      color0 = refined0;
+      color1 = refined1;
+      memcpy(indices, refined_indices, 16);
+    }
+  }
+
+  uint32_t bits = 0;
+  for(int i = 0; i < 16; i++) {
+    bits |= (uint32_t)indices[i] << (2 * i);
+  }
+  block[0] = color0;
+  block[1] = color0 >> 8;
+  block[2] = color1;
+  block[3] = color1 >> 8;
+  block[4] = bits;
+  block[5] = bits >> 8;
+  block[6] = bits >> 16;
+  block[7] = bits >> 24;
+}
+
+static void lgl__ktx_color_decode(const uint8_t block[8], const int four_colors, uint8_t texels[16][4]) {
+  const uint16_t color0 = block[0] | block[1] << 8;
+  const uint16_t color1 = block[2] | block[3] << 8;
+  const uint32_t bits   = block[4] | block[5] << 8 | block[6] << 16 | (uint32_t)block[7] << 24;
+
+  uint8_t palette[4][4];
+  lgl__ktx_color_palette(color0, color1, four_colors, palette);
+  for(int i = 0; i < 16; i++) {
+    memcpy(texels[i], palette[(bits >> (2 * i)) & 3], 4);
+  }
+}
+
+/*Eight alphas between the largest and smallest of the block, or six and
+  0 and 255 when the first is not the larger*/
+static void lgl__ktx_alpha_palette(const uint8_t alpha0, const uint8_t alpha1, uint8_t palette[8]) {
+  palette[0] = alpha0;
+  palette[1] = alpha1;
+  if (alpha0 > alpha1) {
+    for(int i = 2; i < 8; i++) {
+      palette[i] = ((8 - i) * alpha0 + (i - 1) * alpha1) / 7;
+    }
+  } else {
+    for(int i = 2; i < 6; i++) {
+      palette[i] = ((6 - i) * alpha0 + (i - 1) * alpha1) / 5;
+    }
+    palette[6] = 0;
+    palette[7] = 255;
+  }
+}
+
+static void lgl__ktx_alpha_encode(uint8_t texels[16][4], uint8_t block[8]) {
+  uint8_t lowest = 255, highest = 0;
+  for(int i = 0; i < 16; i++) {
+    lowest  = texels[i][3] < lowest  ? texels[i][3] : lowest;
+    highest = texels[i][3] > highest ? texels[i][3] : highest;
+  }
+
+  uint8_t palette[8];
+  lgl__ktx_alpha_palette(highest, lowest, palette);
+
+  uint64_t bits = 0;
+  for(int i = 0; i < 16 && highest != lowest; i++) {
+    int best = 0;
+    for(int p = 1; p < 8; p++) {
+      if (abs(texels[i][3] - palette[p]) < abs(texels[i][3] - palette[best])) {
+        best = p;
+      }
+    }
+    bits |= (uint64_t)best << (3 * i);
+  }
+
+  block[0] = highest;
+  block[1] = lowest;
+  for(int i = 0; i < 6; i++) {
+    block[2 + i] = bits >> (8 * i);
+  }
+}
+
+static void lgl__ktx_alpha_decode(const uint8_t block[8], uint8_t texels[16][4]) {
+  uint8_t palette[8];
+  lgl__ktx_alpha_palette(block[0], block[1], palette);
+
+  uint64_t bits = 0;
+  for(int i = 0; i < 6; i++) {
+    bits |= (uint64_t)block[2 + i] << (8 * i);
+  }
+  for(int i = 0; i < 16; i++) {
+    texels[i][3] = palette[(bits >> (3 * i)) & 7];
+  }
+}
+
+/*-- BC7 -------------------------------------------------------------------*/
+
+static const uint8_t lgl__ktx_bc7_weights[16] = {
+  0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64,
+};
+
+static void lgl__ktx_bc7_bits_write(uint8_t block[16], int *position, const uint32_t value, const int count) {
+  for(int i = 0; i < count; i++, (*position)++) {
+    block[*position >> 3] |= ((value >> i) & 1) << (*position & 7);
+  }
+}
+
+static uint32_t lgl__ktx_bc7_bits_read(const uint8_t block[16], int *position, const int count) {
+  uint32_t value = 0;
+  for(int i = 0; i < count; i++, (*position)++) {
+    value |= (uint32_t)((block[*position >> 3] >> (*position & 7)) & 1) << i;
+  }
+  return value;
+}
+
+static void lgl__ktx_bc7_palette(uint8_t endpoints[2][4], uint8_t palette[16][4]) {
+  for(int i = 0; i < 16; i++) {
+    const int w = lgl__ktx_bc7_weights[i];
+    for(int c = 0; c < 4; c++) {
+      palette[i][c] = ((64 - w) * endpoints[0][c] + w * endpoints[1][c] + 32) >> 6;
+    }
+  }
+}
+
+/*Mode 6 endpoints are 7 bits per channel plus a low bit shared by the
+  channels. Picks whichever low bit lands nearer.*/
+static void lgl__ktx_bc7_quantize(const float color[4], uint8_t quantized[4], uint8_t *low_bit) {
+  float best = INFINITY;
+  for(int p = 0; p < 2; p++) {
+    uint8_t candidate[4];
+    float   error = 0.0f;
+    for(int c = 0; c < 4; c++) {
+      const int q = (int)((color[c] - p) / 2.0f + 0.5f);
+      candidate[c] = q < 0 ? 0 : q > 127 ? 127 : q;
+      const float d = (candidate[c] << 1 | p) - color[c];
+      error += d * d;
+    }
+    if (error < best) {
+      best = error;
+      memcpy(quantized, candidate, 4);
+      *low_bit = p;
+    }
+  }
+}
+
+static void lgl__ktx_bc7_encode(uint8_t texels[16][4], uint8_t block[16]) {
+  float start[4], end[4];
+  lgl__ktx_line_fit(texels, 4, start, end);
+
+  uint8_t quantized[2][4], low_bits[2];
+  lgl__ktx_bc7_quantize(start, quantized[0], &low_bits[0]);
+  lgl__ktx_bc7_quantize(end,   quantized[1], &low_bits[1]);
+
+  uint8_t endpoints[2][4], palette[16][4], indices[16];
+  for(int e = 0; e < 2; e++) {
+    for(int c = 0; c < 4; c++) {
+      endpoints[e][c] = quantized[e][c] << 1 | low_bits[e];
+    }
+  }
+  lgl__ktx_bc7_palette(endpoints, palette);
+  lgl__ktx_indices(texels, 4, 16, palette, indices);
+
+  // the first texel's index drops its top bit, swap the endpoints so it is clear
+  if (indices[0] & 8) {
+    uint8_t swap[4];
+    memcpy(swap, quantized[0], 4);
+    memcpy(quantized[0], quantized[1], 4);
+    memcpy(quantized[1], swap, 4);
+    const uint8_t low_bit = low_bits[0];
+    low_bits[0] = low_bits[1];
+    low_bits[1] = low_bit;
+    for(int i = 0; i < 16; i++) {
+      indices[i] = 15 - indices[i];
+    }
+  }
+
+  memset(block, 0, 16);
+  int position = 0;
+  lgl__ktx_bc7_bits_write(block, &position, 1 << 6, 7); // mode 6
+  for(int c = 0; c < 4; c++) {
+    lgl__ktx_bc7_bits_write(block, &position, quantized[0][c], 7);
+    lgl__ktx_bc7_bits_write(block, &position, quantized[1][c], 7);
+  }
+  lgl__ktx_bc7_bits_write(block, &position, low_bits[0], 1);
+  lgl__ktx_bc7_bits_write(block, &position, low_bits[1], 1);
+  for(int i = 0; i < 16; i++) {
+    lgl__ktx_bc7_bits_write(block, &position, indices[i], i == 0 ? 3 : 4);
+  }
+}
+
+static void lgl__ktx_bc7_decode(const uint8_t block[16], uint8_t texels[16][4]) {
+  if ((block[0] & 0x7f) != 1 << 6) {
+    memset(texels, 0, 16 * 4); // not mode 6
+    return;
+  }
+
+  int     position = 7;
+  uint8_t quantized[2][4], endpoints[2][4], palette[16][4];
+  for(int c = 0; c < 4; c++) {
+    quantized[0][c] = lgl__ktx_bc7_bits_read(block, &position, 7);
+    quantized[1][c] = lgl__ktx_bc7_bits_read(block, &position, 7);
+  }
+  for(int e = 0; e < 2; e++) {
+    const uint8_t low_bit = lgl__ktx_bc7_bits_read(block, &position, 1);
+    for(int c = 0; c < 4; c++) {
+      endpoints[e][c] = quantized[e][c] << 1 | low_bit;
+    }
+  }
+
+  lgl__ktx_bc7_palette(endpoints, palette);
+  for(int i = 0; i < 16; i++) {
+    memcpy(texels[i], palette[lgl__ktx_bc7_bits_read(block, &position, i == 0 ? 3 : 4)], 4);
+  }
+}
+
+/*-- images ----------------------------------------------------------------*/
+
+size_t lgl_ktx_size(const GLenum format, const uint32_t width, const uint32_t height) {
+  const size_t blocks = (size_t)((width + 3) / 4) * ((height + 3) / 4);
+  switch (format) {
+    case LGL_KTX_RGBA8: return (size_t)width * height * 4;
+    case LGL_KTX_BC1:   return blocks * 8;
+    case LGL_KTX_BC3:   return blocks * 16;
+    case LGL_KTX_BC7:   return blocks * 16;
+    default:            return 0;
+  }
+}
+
+void lgl_ktx_encode(
+    const GLenum   format,
+    const uint32_t width,
+    const uint32_t height,
+    const uint8_t *rgba,
+    uint8_t       *blocks) {
+  if (format == LGL_KTX_RGBA8) {
+    memcpy(blocks, rgba, lgl_ktx_size(format, width, height));
+    return;
+  }
+
+  uint8_t texels[16][4];
+  for(uint32_t by = 0; by < (height + 3) / 4; by++) {
+    for(uint32_t bx = 0; bx < (width + 3) / 4; bx++) {
+      lgl__ktx_block_read(width, height, rgba, bx, by, texels);
+      if (format == LGL_KTX_BC1) {
+        lgl__ktx_color_encode(texels, blocks);
+        blocks += 8;
+      } else if (format == LGL_KTX_BC3) {
+        lgl__ktx_alpha_encode(texels, blocks);
+        lgl__ktx_color_encode(texels, blocks + 8);
+        blocks += 16;
+      } else {
+        lgl__ktx_bc7_encode(texels, blocks);
+        blocks += 16;
+      }
+    }
+  }
+}
+
+void lgl_ktx_decode(
+    const GLenum   format,
+    const uint32_t width,
+    const uint32_t height,
+    const uint8_t *blocks,
+    uint8_t       *rgba) {
+  if (format == LGL_KTX_RGBA8) {
+    memcpy(rgba, blocks, lgl_ktx_size(format, width, height));
+    return;
+  }
+
+  uint8_t texels[16][4];
+  for(uint32_t by = 0; by < (height + 3) / 4; by++) {
+    for(uint32_t bx = 0; bx < (width + 3) / 4; bx++) {
+      if (format == LGL_KTX_BC1) {
+        lgl__ktx_color_decode(blocks, 0, texels);
+        blocks += 8;
+      } else if (format == LGL_KTX_BC3) {
+        lgl__ktx_color_decode(blocks + 8, 1, texels);
+        lgl__ktx_alpha_decode(blocks, texels);
+        blocks += 16;
+      } else {
+        lgl__ktx_bc7_decode(blocks, texels);
+        blocks += 16;
+      }
+      lgl__ktx_block_write(width, height, rgba, bx, by, texels);
+    }
+  }
+}
+
+/*-- files -----------------------------------------------------------------*/
+
+static const uint8_t lgl__ktx_identifier[12] = {
+  0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n',
+};
+
+// rows run bottom up, like GL and unlike most images
+static const char lgl__ktx_orientation[] = "KTXorientation\0S=r,T=u";
+
+int lgl_ktx_write(
+    FILE           *file,
+    const GLenum    format,
+    const uint32_t  width,
+    const uint32_t  height,
+    const uint32_t  levels_count,
+    const uint8_t **levels) {
+  const uint32_t key_value_size = sizeof(lgl__ktx_orientation);
+  const uint32_t key_value_pad  = (4 - key_value_size % 4) % 4;
+
+  lgl_ktx_header_t header = {
+    .endianness               = 0x04030201,
+    .gl_type                  = format == LGL_KTX_RGBA8 ? GL_UNSIGNED_BYTE : 0,
+    .gl_type_size             = 1,
+    .gl_format                = format == LGL_KTX_RGBA8 ? GL_RGBA : 0,
+    .gl_internal_format       = format,
+    .gl_base_internal_format  = format == LGL_KTX_BC1 ? GL_RGB : GL_RGBA,
+    .pixel_width              = width,
+    .pixel_height             = height,
+    .number_of_faces          = 1,
+    .number_of_mipmap_levels  = levels_count,
+    .bytes_of_key_value_data  = sizeof(key_value_size) + key_value_size + key_value_pad,
+  };
+  memcpy(header.identifier, lgl__ktx_identifier, sizeof(header.identifier));
+
+  static const uint8_t zeros[4] = {0};
+  int written = fwrite(&header, sizeof(header), 1, file) == 1;
+  written    &= fwrite(&key_value_size, sizeof(key_value_size), 1, file) == 1;
+  written    &= fwrite(lgl__ktx_orientation, key_value_size, 1, file) == 1;
+  written    &= fwrite(zeros, 1, key_value_pad, file) == key_value_pad;
+
+  for(uint32_t i = 0; i < levels_count; i++) {
+    const uint32_t level_width  = width  >> i ? width  >> i : 1;
+    const uint32_t level_height = height >> i ? height >> i : 1;
+    const uint32_t size         = lgl_ktx_size(format, level_width, level_height);
+    written &= fwrite(&size, sizeof(size), 1, file) == 1;
+    written &= fwrite(levels[i], size, 1, file) == 1;
+    written &= fwrite(zeros, 1, (4 - size % 4) % 4, file) == (4 - size % 4) % 4;
+  }
+  return written;
+}
+
+int lgl_ktx_parse(const void *file, const size_t length, lgl_ktx_t *ktx) {
+  lgl_ktx_header_t header;
+  if (length < sizeof(header)) {
+    debug_error("KTX file is too short for its header");
+    return 0;
+  }
+  memcpy(&header, file, sizeof(header));
+
+  if (memcmp(header.identifier, lgl__ktx_identifier, sizeof(header.identifier)) != 0) {
+    debug_error("not a KTX 1.1 file");
+    return 0;
+  }
+  if (header.endianness != 0x04030201) {
+    debug_error("KTX file is in the other byte order");
+    return 0;
+  }
+  if (header.pixel_width == 0 || header.pixel_height == 0 || header.pixel_depth != 0 ||
+      header.number_of_array_elements != 0 || header.number_of_faces != 1) {
+    debug_error("KTX file is not a 2D texture");
+    return 0;
+  }
+
+  const GLenum format = header.gl_internal_format;
+  if (lgl_ktx_size(format, 1, 1) == 0 ||
+      (format == LGL_KTX_RGBA8 && (header.gl_format != GL_RGBA || header.gl_type != GL_UNSIGNED_BYTE))) {
+    debug_error("KTX file has an unsupported format 0x%x", format);
+    return 0;
+  }
+
+  // 0 levels asks the loader to build them, take the base level alone
+  const uint32_t levels_count = header.number_of_mipmap_levels ? header.number_of_mipmap_levels : 1;
+  uint32_t       levels_max   = 1;
+  while ((header.pixel_width | header.pixel_height) >> levels_max) {
+    levels_max++;
+  }
+  if (levels_count > levels_max || levels_count > LGL_KTX_LEVELS_MAX) {
+    debug_error("KTX file has %u levels, a %ux%u texture has at most %u",
+        levels_count, header.pixel_width, header.pixel_height, levels_max);
+    return 0;
+  }
+
+  size_t offset = sizeof(header) + (size_t)header.bytes_of_key_value_data;
+  for(uint32_t i = 0; i < levels_count; i++) {
+    const uint32_t level_width  = header.pixel_width  >> i ? header.pixel_width  >> i : 1;
+    const uint32_t level_height = header.pixel_height >> i ? header.pixel_height >> i : 1;
+    const size_t   expected     = lgl_ktx_size(format, level_width, level_height);
+
+    uint32_t size;
+    if (offset > length || length - offset < sizeof(size)) {
+      debug_error("KTX file ends before level %u", i);
+      return 0;
+    }
+    memcpy(&size, (const uint8_t*)file + offset, sizeof(size));
+    offset += sizeof(size);
+
+    if (size != expected) {
+      debug_error("KTX level %u holds %u bytes, %lu expected", i, size, expected);
+      return 0;
+    }
+    if (length - offset < size) {
+      debug_error("KTX file ends inside level %u", i);
+      return 0;
+    }
+    ktx->levels[i]      = (const uint8_t*)file + offset;
+    ktx->level_sizes[i] = size;
+    offset += size + (4 - size % 4) % 4;
+  }
+
+  ktx->format       = format;
+  ktx->width        = header.pixel_width;
+  ktx->height       = header.pixel_height;
+  ktx->levels_count = levels_count;
+  return 1;
+}
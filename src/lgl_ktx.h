@@ -0,0 +1,102 @@
+/*--------------------------------------------------------------------------/
+/                                                                           /
+/ lgl_ktx.h                                                                 /
+/ KTX texture files and block compression that need no GL context           /
+/                                                                           /
+/--------------------------------------------------------------------------*/
+
+#ifndef LGL_KTX_H
+#define LGL_KTX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif // ifdef __cplusplus
+
+#include "lgl.h"
+
+#define LGL_KTX_LEVELS_MAX 16 // enough for a 32768 texel side
+
+/*Formats lgl_ktx_encode writes and lgl_ktx_decode reads, as GL internal
+  formats. BC1 is 8 bytes per 4x4 block and opaque, BC3 and BC7 are 16
+  bytes per block with alpha. BC7 blocks are only ever written in mode 6,
+  one RGBA line per block, and only mode 6 blocks decode.*/
+#define LGL_KTX_RGBA8 GL_RGBA8
+#define LGL_KTX_BC1   GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define LGL_KTX_BC3   GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define LGL_KTX_BC7   GL_COMPRESSED_RGBA_BPTC_UNORM
+
+/*KTX 1.1 files, see khronos.org/opengles/sdk/tools/KTX/file_format_spec.
+  The header is followed by bytes_of_key_value_data of metadata, then each
+  level as a 32-bit size and its texels, 4 byte aligned.*/
+typedef struct {
+  uint8_t        identifier[12]; // «KTX 11»\r\n\x1A\n
+  uint32_t       endianness;     // 0x04030201 in the writer's byte order
+  uint32_t       gl_type;        // 0 for compressed formats
+  uint32_t       gl_type_size;
+  uint32_t       gl_format;      // 0 for compressed formats
+  uint32_t       gl_internal_format;
+  uint32_t       gl_base_internal_format;
+  uint32_t       pixel_width;
+  uint32_t       pixel_height;
+  uint32_t       pixel_depth;
+  uint32_t       number_of_array_elements;
+  uint32_t       number_of_faces;
+  uint32_t       number_of_mipmap_levels;
+  uint32_t       bytes_of_key_value_data;
+} lgl_ktx_header_t;
+
+/*A 2D texture with its mip chain. Levels point into the file it was read
+  from.*/
+typedef struct {
+  GLenum         format;         // one of LGL_KTX_*
+  uint32_t       width;
+  uint32_t       height;
+  uint32_t       levels_count;
+  const uint8_t *levels[LGL_KTX_LEVELS_MAX];
+  size_t         level_sizes[LGL_KTX_LEVELS_MAX];
+} lgl_ktx_t;
+
+/*Bytes a width by height image takes in format, 0 for unknown formats*/
+size_t lgl_ktx_size  (const GLenum   format,
+                      const uint32_t width,
+                      const uint32_t height);
+
+/*Compresses tightly packed RGBA8 texels into format. Sides that are not a
+  multiple of 4 are padded by repeating the last row and column.*/
+void   lgl_ktx_encode(const GLenum   format,
+                      const uint32_t width,
+                      const uint32_t height,
+                      const uint8_t *rgba,
+                      uint8_t       *blocks);
+
+/*Decompresses format into tightly packed RGBA8, for drivers that cannot
+  sample it*/
+void   lgl_ktx_decode(const GLenum   format,
+                      const uint32_t width,
+                      const uint32_t height,
+                      const uint8_t *blocks,
+                      uint8_t       *rgba);
+
+/*Writes levels_count levels, each half the size of the one before down to
+  1, as a KTX file. Levels are in lgl_ktx_size(format, ...) bytes. The file
+  says rows run bottom up, the way stb_image is asked to load them. Returns
+  0 when the file could not be written.*/
+int    lgl_ktx_write (FILE           *file,
+                      const GLenum    format,
+                      const uint32_t  width,
+                      const uint32_t  height,
+                      const uint32_t  levels_count,
+                      const uint8_t **levels);
+
+/*Checks a KTX file in memory holds a 2D texture in one of the LGL_KTX_*
+  formats and that its levels are inside it. Returns 0 with the problem
+  logged.*/
+int    lgl_ktx_parse (const void    *file,
+                      const size_t   length,
+                      lgl_ktx_t     *ktx);
+
+#ifdef __cplusplus
+}
+#endif // ifdef __cplusplus
+
+#endif // LGL_KTX_H
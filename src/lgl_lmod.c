@@ -0,0 +1,620 @@
+#include "lgl_lmod.h"
+#include "lgl_mesh.h"
+
+/*-- numbers ---------------------------------------------------------------*/
+
+static const double lgl__lmod_powers[] = {
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+#define LGL__LMOD_DIGITS 15 // significant digits kept, every 15 digit integer is below 2^53
+
+static inline int lgl__lmod_digit(const char c) {
+  return (unsigned char)(c - '0') < 10;
+}
+
+/*Parses a decimal number with an optional sign, fraction and exponent.
+  The first 15 significant digits are kept, exact as a double, and scaled
+  by powers of ten that are exact up to 1e22. That is well past the 9
+  digits a float holds, so only contrived inputs sitting on a halfway point
+  between two floats can round differently from strtof. Returns the end of the number, or start
+  when there is none.*/
+static inline const char *lgl__lmod_float(const char *start, const char *end, float *value) {
+  const char *c = start;
+
+  const int negative = c < end && *c == '-';
+  c += c < end && (*c == '-' || *c == '+');
+
+  uint64_t mantissa = 0;
+  int      digits   = 0;
+  int      exponent = 0;
+  int      any      = 0;
+
+  for(; c < end && lgl__lmod_digit(*c); c++, any = 1) {
+    if (digits < LGL__LMOD_DIGITS) {
+      mantissa = mantissa * 10 + (*c - '0');
+      digits  += mantissa != 0;
+    } else {
+      exponent++;
+    }
+  }
+  if (c < end && *c == '.') {
+    for(c++; c < end && lgl__lmod_digit(*c); c++, any = 1) {
+      if (digits < LGL__LMOD_DIGITS) {
+        mantissa = mantissa * 10 + (*c - '0');
+        digits  += mantissa != 0;
+        exponent--;
+      }
+    }
+  }
+  if (!any) {
+    return start;
+  }
+
+  if (c < end && (*c == 'e' || *c == 'E')) {
+    const char *e = c + 1;
+    const int   exponent_negative = e < end && *e == '-';
+    e += e < end && (*e == '-' || *e == '+');
+    if (e == end || !lgl__lmod_digit(*e)) {
+      return start;
+    }
+
+    int written = 0;
+    for(; e < end && lgl__lmod_digit(*e); e++) {
+      written = written < 10000 ? written * 10 + (*e - '0') : written;
+    }
+    exponent += exponent_negative ? -written : written;
+    c = e;
+  }
+
+  double result = mantissa;
+  if (mantissa != 0) {
+    for(; exponent > 22;  exponent -= 22) result *= 1e22;
+    for(; exponent < -22; exponent += 22) result /= 1e22;
+    result = exponent < 0 ? result / lgl__lmod_powers[-exponent] : result * lgl__lmod_powers[exponent];
+  }
+
+  *value = negative ? -result : result;
+  return c;
+}
+
+/*Parses an unsigned decimal that fits 32 bits, see lgl__lmod_float*/
+static inline const char *lgl__lmod_index(const char *start, const char *end, uint32_t *value) {
+  uint64_t    result = 0;
+  const char *c      = start;
+  for(; c < end && lgl__lmod_digit(*c) && result <= UINT32_MAX; c++) {
+    result = result * 10 + (*c - '0');
+  }
+  if (result > UINT32_MAX) {
+    return start;
+  }
+  *value = result;
+  return c;
+}
+
+/*-- parsing ---------------------------------------------------------------*/
+
+static inline int lgl__lmod_space(const char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+typedef enum {
+  LGL__LMOD_SECTION_NONE,
+  LGL__LMOD_SECTION_POSITIONS,
+  LGL__LMOD_SECTION_NORMALS,
+  LGL__LMOD_SECTION_TEXTURE_COORDINATES,
+  LGL__LMOD_SECTION_INDICES,
+} lgl__lmod_section_t;
+
+/*The mesh: section being read. Values go straight into the arrays the
+  mesh ends up with. Texture coordinates are stored in the vertices
+  whether they are per vertex or per index, the vertex array grows to hold
+  as many of them as there are.*/
+typedef struct {
+  lgl_lmod_t     mesh;
+  size_t         vertices_capacity;
+  size_t         indices_capacity;
+  size_t         positions_count;   // floats read so far
+  size_t         normals_count;
+  size_t         uvs_count;
+} lgl__lmod_builder_t;
+
+static inline lgl_vertex_t *lgl__lmod_vertex(lgl__lmod_builder_t *builder, const size_t i) {
+  if (i >= builder->vertices_capacity) {
+    const size_t capacity = builder->vertices_capacity ? builder->vertices_capacity * 2 : 1024;
+    builder->mesh.vertices = realloc(builder->mesh.vertices, capacity * sizeof(*builder->mesh.vertices));
+    memset(&builder->mesh.vertices[builder->vertices_capacity], 0,
+        (capacity - builder->vertices_capacity) * sizeof(*builder->mesh.vertices));
+    builder->vertices_capacity = capacity;
+  }
+  return &builder->mesh.vertices[i];
+}
+
+static inline void lgl__lmod_index_push(lgl__lmod_builder_t *builder, const uint32_t index) {
+  if (builder->mesh.index_count == builder->indices_capacity) {
+    builder->indices_capacity = builder->indices_capacity ? builder->indices_capacity * 2 : 3072;
+    builder->mesh.indices = realloc(builder->mesh.indices,
+        builder->indices_capacity * sizeof(*builder->mesh.indices));
+  }
+  builder->mesh.indices[builder->mesh.index_count++] = index;
+}
+
+/*Checks what a mesh: section listed and trims its arrays. Per index
+  texture coordinates need one vertex per index, which welding merges
+  again. Files written by lmod_optimize list them per vertex and skip
+  that. Returns 0 when the section does not describe a mesh.*/
+static int lgl__lmod_finish(lgl__lmod_builder_t *builder) {
+  lgl_lmod_t   *mesh         = &builder->mesh;
+  const char   *name         = mesh->name;
+  const size_t  vertex_count = builder->positions_count / 3;
+
+  lgl_lod_t *last = &mesh->levels[mesh->levels_count - 1];
+  last->count = mesh->index_count - last->first;
+
+  for(uint8_t i = 0; i < mesh->levels_count; i++) {
+    if (mesh->levels[i].count % 3 != 0) {
+      debug_error("mesh \"%s\" level %d has %d indices, not whole triangles",
+          name, i, mesh->levels[i].count);
+      return 0;
+    }
+  }
+  for(size_t i = 0; i < mesh->index_count; i++) {
+    if (mesh->indices[i] >= vertex_count) {
+      debug_error("mesh \"%s\" index %u is out of range, it has %lu vertices",
+          name, mesh->indices[i], vertex_count);
+      return 0;
+    }
+  }
+
+  // vertex_count entries are always there, the array grows ahead of them
+  lgl__lmod_vertex(builder, vertex_count);
+
+  if (builder->normals_count && builder->normals_count != vertex_count * 3) {
+    debug_warn("mesh \"%s\" has %lu normals for %lu vertices, ignoring them",
+        name, builder->normals_count / 3, vertex_count);
+    for(size_t i = 0; i < vertex_count; i++) {
+      mesh->vertices[i].normal = (lgl_3f_t) {0};
+    }
+  }
+
+  const size_t uvs_count = builder->uvs_count / 2;
+  if (uvs_count && uvs_count != vertex_count) {
+    if (uvs_count == mesh->index_count) {
+      lgl_vertex_t *corners = malloc(mesh->index_count * sizeof(*corners));
+      for(size_t i = 0; i < mesh->index_count; i++) {
+        corners[i] = (lgl_vertex_t) {
+          .position            = mesh->vertices[mesh->indices[i]].position,
+          .normal              = mesh->vertices[mesh->indices[i]].normal,
+          .texture_coordinates = mesh->vertices[i].texture_coordinates,
+        };
+      }
+
+      // the vertex array already holds one entry per texture coordinate
+      mesh->vertex_count = lgl_mesh_weld(mesh->index_count, corners, mesh->vertices, mesh->indices);
+      free(corners);
+    } else {
+      debug_warn("mesh \"%s\" has %lu texture coordinates for %lu vertices and %lu indices, ignoring them",
+          name, uvs_count, vertex_count, mesh->index_count);
+      for(size_t i = 0; i < vertex_count; i++) {
+        mesh->vertices[i].texture_coordinates = (lgl_2f_t) {0};
+      }
+      mesh->vertex_count = vertex_count;
+    }
+  } else {
+    mesh->vertex_count = vertex_count;
+  }
+
+  // without vertex_indices: the vertices are a triangle list, welded and
+  // indexed like every other mesh so the tools can optimize it
+  if (mesh->index_count == 0 && mesh->vertex_count > 0) {
+    if (mesh->vertex_count % 3 != 0) {
+      debug_error("mesh \"%s\" has no indices and %lu vertices, not whole triangles",
+          name, mesh->vertex_count);
+      return 0;
+    }
+
+    lgl_vertex_t *corners = malloc(mesh->vertex_count * sizeof(*corners));
+    memcpy(corners, mesh->vertices, mesh->vertex_count * sizeof(*corners));
+
+    mesh->index_count     = mesh->vertex_count;
+    mesh->indices         = realloc(mesh->indices, mesh->index_count * sizeof(*mesh->indices));
+    mesh->vertex_count    = lgl_mesh_weld(mesh->index_count, corners, mesh->vertices, mesh->indices);
+    mesh->levels[0].count = mesh->index_count;
+    free(corners);
+  }
+
+  mesh->vertices = realloc(mesh->vertices, (mesh->vertex_count ? mesh->vertex_count : 1) * sizeof(*mesh->vertices));
+  mesh->indices  = realloc(mesh->indices,  (mesh->index_count  ? mesh->index_count  : 1) * sizeof(*mesh->indices));
+  return 1;
+}
+
+/*Whether the token from c to end is keyword, colon included*/
+static inline int lgl__lmod_keyword(const char *c, const size_t length, const char *keyword) {
+  return strlen(keyword) == length && memcmp(c, keyword, length) == 0;
+}
+
+size_t lgl_lmod_parse(const char *text, const size_t length, lgl_lmod_t **meshes) {
+  lgl_lmod_t         *parsed   = NULL;
+  size_t              count    = 0;
+  size_t              capacity = 0;
+  lgl__lmod_builder_t builder  = {0};
+  lgl__lmod_section_t section  = LGL__LMOD_SECTION_NONE;
+  int                 started  = 0;
+  int                 failed   = 0;
+  size_t              line     = 1;
+
+  const char *end = text + length;
+
+  *meshes = NULL;
+
+  for(const char *c = text;;) {
+    while (c < end && lgl__lmod_space(*c)) {
+      line += *c++ == '\n';
+    }
+    if (c < end && *c == '#') {
+      c = memchr(c, '\n', end - c);
+      c = c ? c : end;
+      continue;
+    }
+
+    // values are the common case, their section says how to read them
+    if (c < end && section != LGL__LMOD_SECTION_NONE && (lgl__lmod_digit(*c) || *c == '-' || *c == '.' || *c == '+')) {
+      const char *next = c;
+      if (section == LGL__LMOD_SECTION_INDICES) {
+        uint32_t index;
+        next = lgl__lmod_index(c, end, &index);
+        if (next != c) {
+          lgl__lmod_index_push(&builder, index);
+        }
+      } else {
+        float value;
+        next = lgl__lmod_float(c, end, &value);
+        if (next != c) {
+          size_t *counter =
+            section == LGL__LMOD_SECTION_POSITIONS ? &builder.positions_count :
+            section == LGL__LMOD_SECTION_NORMALS   ? &builder.normals_count   :
+                                                     &builder.uvs_count;
+          const size_t  i      = (*counter)++;
+          lgl_vertex_t *vertex = lgl__lmod_vertex(&builder,
+              section == LGL__LMOD_SECTION_TEXTURE_COORDINATES ? i / 2 : i / 3);
+
+          if (section == LGL__LMOD_SECTION_POSITIONS) {
+            (&vertex->position.x)[i % 3] = value;
+          } else if (section == LGL__LMOD_SECTION_NORMALS) {
+            (&vertex->normal.x)[i % 3] = value;
+          } else {
+            (&vertex->texture_coordinates.x)[i % 2] = value;
+          }
+        }
+      }
+
+      if (next != c && (next == end || lgl__lmod_space(*next) || *next == '#')) {
+        c = next;
+        continue;
+      }
+    }
+
+    const char *token = c;
+    while (c < end && !lgl__lmod_space(*c) && *c != '#') {
+      c++;
+    }
+    const size_t token_length = c - token;
+
+    // a mesh ends where the next one starts, or with the file
+    if (token_length == 0 || lgl__lmod_keyword(token, token_length, "mesh:")) {
+      if (started) {
+        if (!lgl__lmod_finish(&builder)) {
+          failed = 1;
+          break;
+        }
+        if (count == capacity) {
+          capacity = capacity ? capacity * 2 : 4;
+          parsed   = realloc(parsed, capacity * sizeof(*parsed));
+        }
+        parsed[count++] = builder.mesh;
+        builder = (lgl__lmod_builder_t){0};
+      }
+      if (token_length == 0) {
+        break;
+      }
+
+      // the name is the rest of the line
+      while (c < end && (*c == ' ' || *c == '\t')) {
+        c++;
+      }
+      const char *name_end = c;
+      while (name_end < end && *name_end != '\n' && *name_end != '#') {
+        name_end++;
+      }
+      while (name_end > c && lgl__lmod_space(name_end[-1])) {
+        name_end--;
+      }
+      builder.mesh.name         = strndup(c, name_end - c);
+      builder.mesh.levels_count = 1;
+      started                   = 1;
+      section                   = LGL__LMOD_SECTION_NONE;
+      c                         = name_end;
+      continue;
+    }
+
+    if (!started) {
+      builder.mesh.name         = strdup(""); // values before any mesh: make an unnamed one
+      builder.mesh.levels_count = 1;
+      started                   = 1;
+    }
+
+    if (token[token_length - 1] != ':') {
+      debug_error("line %lu: expected a number, found %.*s", line, (int)token_length, token);
+      failed = 1;
+      break;
+    }
+
+    section = LGL__LMOD_SECTION_NONE;
+    if (lgl__lmod_keyword(token, token_length, "vertex_positions:")) {
+      section = LGL__LMOD_SECTION_POSITIONS;
+    } else if (lgl__lmod_keyword(token, token_length, "vertex_normals:")) {
+      section = LGL__LMOD_SECTION_NORMALS;
+    } else if (lgl__lmod_keyword(token, token_length, "vertex_texture_coordinates:")) {
+      section = LGL__LMOD_SECTION_TEXTURE_COORDINATES;
+    } else if (lgl__lmod_keyword(token, token_length, "vertex_indices:")) {
+      section = LGL__LMOD_SECTION_INDICES;
+    } else if (lgl__lmod_keyword(token, token_length, "level_of_detail:")) {
+      while (c < end && (*c == ' ' || *c == '\t')) {
+        c++;
+      }
+      float screen_size;
+      const char *next = lgl__lmod_float(c, end, &screen_size);
+      if (next == c) {
+        debug_error("line %lu: level_of_detail: needs a screen size", line);
+        failed = 1;
+        break;
+      }
+      c = next;
+
+      lgl_lmod_t *mesh  = &builder.mesh;
+      lgl_lod_t  *level = &mesh->levels[mesh->levels_count - 1];
+      if (mesh->index_count > (size_t)level->first) {
+        if (mesh->levels_count == LGL_LOD_MAX) {
+          debug_error("line %lu: a mesh has at most %d levels of detail", line, LGL_LOD_MAX);
+          failed = 1;
+          break;
+        }
+        level->count = mesh->index_count - level->first;
+        level        = &mesh->levels[mesh->levels_count++];
+        level->first = mesh->index_count;
+      }
+      level->screen_size = screen_size;
+    } else {
+      debug_warn("line %lu: skipping unknown section %.*s", line, (int)token_length, token);
+    }
+  }
+
+  free(builder.mesh.name);
+  free(builder.mesh.vertices);
+  free(builder.mesh.indices);
+
+  if (failed || count == 0) {
+    lgl_lmod_free(count, parsed);
+    return 0;
+  }
+  *meshes = parsed;
+  return count;
+}
+
+void lgl_lmod_free(const size_t meshes_count, lgl_lmod_t *meshes) {
+  for(size_t i = 0; i < meshes_count; i++) {
+    free(meshes[i].name);
+    free(meshes[i].vertices);
+    free(meshes[i].indices);
+  }
+  free(meshes);
+}
+
+void lgl_lmod_write(FILE *file, const lgl_lmod_t *mesh) {
+  fprintf(file, "mesh: %s\n", mesh->name);
+
+  fprintf(file, "vertex_positions:\n");
+  for(size_t i = 0; i < mesh->vertex_count; i++) {
+    const lgl_3f_t p = mesh->vertices[i].position;
+    fprintf(file, "%.9g\t%.9g\t%.9g\n", p.x, p.y, p.z);
+  }
+
+  fprintf(file, "vertex_normals:\n");
+  for(size_t i = 0; i < mesh->vertex_count; i++) {
+    const lgl_3f_t n = mesh->vertices[i].normal;
+    fprintf(file, "%.9g\t%.9g\t%.9g\n", n.x, n.y, n.z);
+  }
+
+  fprintf(file, "vertex_texture_coordinates:\n");
+  for(size_t i = 0; i < mesh->vertex_count; i++) {
+    const lgl_2f_t uv = mesh->vertices[i].texture_coordinates;
+    fprintf(file, "%.9g\t%.9g\n", uv.x, uv.y);
+  }
+
+  for(uint8_t l = 0; l < mesh->levels_count; l++) {
+    const lgl_lod_t *level = &mesh->levels[l];
+    if (mesh->levels_count > 1) {
+      fprintf(file, "level_of_detail: %.9g\n", level->screen_size);
+    }
+
+    fprintf(file, "vertex_indices:\n");
+    for(GLsizei i = 0; i < level->count; i++) {
+      fprintf(file, "%u ", mesh->indices[level->first + i]);
+    }
+    fprintf(file, "\n");
+  }
+}
+
+char *lgl_lmod_read(const char *path, size_t *length) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    debug_error("failed to open %s", path);
+    return NULL;
+  }
+
+  fseek(file, 0, SEEK_END);
+  *length = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  char *text = malloc(*length ? *length : 1);
+  if (fread(text, 1, *length, file) != *length) {
+    debug_error("failed to read %s", path);
+    free(text);
+    text = NULL;
+  }
+
+  fclose(file);
+  return text;
+}
+
+/*-- binary ----------------------------------------------------------------*/
+
+uint64_t lgl_lmod_hash(const void *data, const size_t length) {
+  const unsigned char *bytes = data;
+
+  uint64_t hash = 14695981039346656037ull;
+  size_t   i    = 0;
+  for(; i + 8 <= length; i += 8) {
+    uint64_t word;
+    memcpy(&word, &bytes[i], sizeof(word));
+    hash = (hash ^ word) * 1099511628211ull;
+  }
+  for(; i < length; i++) {
+    hash = (hash ^ bytes[i]) * 1099511628211ull;
+  }
+  return hash;
+}
+
+static inline uint64_t lgl__lmodb_align(const uint64_t offset) {
+  return (offset + LGL_LMODB_ALIGNMENT - 1) & ~(uint64_t)(LGL_LMODB_ALIGNMENT - 1);
+}
+
+static inline size_t lgl__lmodb_vertex_size(const GLint vertex_format) {
+  return vertex_format == LGL_VERTEX_FORMAT_PACKED ?
+    sizeof(lgl_vertex_packed_t) : sizeof(lgl_vertex_t);
+}
+
+int lgl_lmodb_write(
+    FILE             *file,
+    const size_t      meshes_count,
+    const lgl_lmod_t *meshes,
+    const GLint       vertex_format) {
+
+  const size_t vertex_size = lgl__lmodb_vertex_size(vertex_format);
+
+  // the whole file is put together in memory so it can be hashed
+  uint64_t length = lgl__lmodb_align(
+      sizeof(lgl_lmodb_header_t) + meshes_count * sizeof(lgl_lmodb_mesh_t));
+  for(size_t i = 0; i < meshes_count; i++) {
+    length = lgl__lmodb_align(length + meshes[i].vertex_count * vertex_size);
+    length = lgl__lmodb_align(length + meshes[i].index_count  * sizeof(uint32_t));
+  }
+
+  unsigned char *buffer = calloc(length, 1);
+
+  lgl_lmodb_header_t *header = (lgl_lmodb_header_t*)buffer;
+  lgl_lmodb_mesh_t   *table  = (lgl_lmodb_mesh_t*)(header + 1);
+
+  uint64_t offset = lgl__lmodb_align(
+      sizeof(lgl_lmodb_header_t) + meshes_count * sizeof(lgl_lmodb_mesh_t));
+
+  for(size_t i = 0; i < meshes_count; i++) {
+    const lgl_lmod_t *mesh  = &meshes[i];
+    lgl_lmodb_mesh_t *entry = &table[i];
+
+    snprintf(entry->name, sizeof(entry->name), "%s", mesh->name);
+    entry->bounds        = lgl_bounds_compute(mesh->vertex_count, mesh->vertices);
+    entry->vertex_format = vertex_format;
+    entry->vertex_count  = mesh->vertex_count;
+    entry->index_count   = mesh->index_count;
+    entry->levels_count  = mesh->levels_count > 1 ? mesh->levels_count : 0;
+    memcpy(entry->levels, mesh->levels, sizeof(entry->levels));
+
+    entry->vertices_offset = offset;
+    if (vertex_format == LGL_VERTEX_FORMAT_PACKED) {
+      lgl_mesh_quantize(mesh->vertex_count, mesh->vertices, &entry->bounds,
+          (lgl_vertex_packed_t*)&buffer[offset]);
+    } else {
+      memcpy(&buffer[offset], mesh->vertices, mesh->vertex_count * vertex_size);
+    }
+    offset = lgl__lmodb_align(offset + mesh->vertex_count * vertex_size);
+
+    entry->indices_offset = offset;
+    memcpy(&buffer[offset], mesh->indices, mesh->index_count * sizeof(uint32_t));
+    offset = lgl__lmodb_align(offset + mesh->index_count * sizeof(uint32_t));
+  }
+
+  memcpy(header->magic, "LMDB", 4);
+  header->version      = LGL_LMODB_VERSION;
+  header->meshes_count = meshes_count;
+  header->length       = length;
+  header->hash         = lgl_lmod_hash(header + 1, length - sizeof(*header));
+
+  const int written = fwrite(buffer, 1, length, file) == length;
+  free(buffer);
+  return written;
+}
+
+const lgl_lmodb_mesh_t *lgl_lmodb_validate(
+    const void  *file,
+    const size_t length,
+    const int    verify) {
+
+  const lgl_lmodb_header_t *header = file;
+  if (length < sizeof(*header) || memcmp(header->magic, "LMDB", 4) != 0) {
+    debug_error("not an .lmodb file");
+    return NULL;
+  }
+  if (header->version != LGL_LMODB_VERSION) {
+    debug_error(".lmodb version %u, expected %d", header->version, LGL_LMODB_VERSION);
+    return NULL;
+  }
+  if (header->length != length ||
+      header->meshes_count > (length - sizeof(*header)) / sizeof(lgl_lmodb_mesh_t)) {
+    debug_error(".lmodb file is truncated");
+    return NULL;
+  }
+
+  const lgl_lmodb_mesh_t *table = (const lgl_lmodb_mesh_t*)(header + 1);
+  for(uint32_t i = 0; i < header->meshes_count; i++) {
+    const lgl_lmodb_mesh_t *mesh = &table[i];
+    const uint64_t
+      vertices_size = (uint64_t)mesh->vertex_count * lgl__lmodb_vertex_size(mesh->vertex_format),
+      indices_size  = (uint64_t)mesh->index_count  * sizeof(uint32_t);
+
+    if (mesh->vertices_offset % LGL_LMODB_ALIGNMENT || mesh->indices_offset % LGL_LMODB_ALIGNMENT ||
+        mesh->vertices_offset > length || vertices_size > length - mesh->vertices_offset ||
+        mesh->indices_offset  > length || indices_size  > length - mesh->indices_offset  ||
+        mesh->levels_count > LGL_LOD_MAX || memchr(mesh->name, '\0', sizeof(mesh->name)) == NULL) {
+      debug_error(".lmodb mesh %u is out of bounds", i);
+      return NULL;
+    }
+    for(uint32_t l = 0; l < mesh->levels_count; l++) {
+      const lgl_lod_t *level = &mesh->levels[l];
+      if (level->first < 0 || level->count < 0 ||
+          (uint64_t)level->first + level->count > mesh->index_count) {
+        debug_error(".lmodb mesh %u level %u is out of bounds", i, l);
+        return NULL;
+      }
+    }
+  }
+
+  if (verify) {
+    if (lgl_lmod_hash(header + 1, length - sizeof(*header)) != header->hash) {
+      debug_error(".lmodb file does not match its hash");
+      return NULL;
+    }
+
+    for(uint32_t i = 0; i < header->meshes_count; i++) {
+      const uint32_t *indices = (const uint32_t*)((const char*)file + table[i].indices_offset);
+      for(uint32_t j = 0; j < table[i].index_count; j++) {
+        if (indices[j] >= table[i].vertex_count) {
+          debug_error(".lmodb mesh %u index %u is out of range", i, j);
+          return NULL;
+        }
+      }
+    }
+  }
+  return table;
+}
@@ -0,0 +1,106 @@
+/*--------------------------------------------------------------------------/
+/                                                                           /
+/ lgl_lmod.h                                                                /
+/ Reading and writing .lmod meshes, see res/models/lmod-exporter.py         /
+/                                                                           /
+/--------------------------------------------------------------------------*/
+
+#ifndef LGL_LMOD_H
+#define LGL_LMOD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif // ifdef __cplusplus
+
+#include "lgl.h"
+
+/*One mesh: section of a file. Positions and normals are listed per vertex.
+  Texture coordinates are per vertex when there are as many as vertices,
+  otherwise one per index as the exporter writes them. A level_of_detail:
+  keyword with a screen size starts another vertex_indices: list over the
+  same vertices, see lgl_lod_t.
+
+  Parsed meshes are indexed even when the file lists texture coordinates
+  per index or has no vertex_indices: at all, those are welded into unique
+  vertices. Every level's indices are in one array and levels_count is at
+  least 1.*/
+typedef struct {
+  char          *name;
+  lgl_vertex_t  *vertices;
+  size_t         vertex_count;
+  uint32_t      *indices;
+  size_t         index_count;
+  lgl_lod_t      levels[LGL_LOD_MAX];
+  uint8_t        levels_count;
+} lgl_lmod_t;
+
+/*Parses the meshes of an .lmod file's text in one pass, it need not be nul
+  terminated. Writes them to *meshes and returns how many there are, 0 on
+  errors. Free them with lgl_lmod_free.*/
+size_t lgl_lmod_parse (const char *text, const size_t length, lgl_lmod_t **meshes);
+void   lgl_lmod_free  (const size_t meshes_count, lgl_lmod_t *meshes);
+
+/*Writes a mesh the way lgl_lmod_parse reads it, texture coordinates per
+  vertex*/
+void   lgl_lmod_write (FILE *file, const lgl_lmod_t *mesh);
+
+/*Reads a whole file for lgl_lmod_parse, for the offline tools. The engine
+  maps files instead, see lgl_lmod_alloc. Returns NULL with the problem
+  logged, free the text when done.*/
+char  *lgl_lmod_read  (const char *path, size_t *length);
+
+/*-- binary ----------------------------------------------------------------*/
+
+#define LGL_LMODB_VERSION   1
+#define LGL_LMODB_ALIGNMENT 64 // sections start on cache lines
+
+/*Compiled .lmodb files are a header, a table of meshes_count meshes and
+  then each mesh's vertex and index sections, LGL_LMODB_ALIGNMENT aligned.
+  Sections hold exactly what the GL buffers hold, so they are uploaded
+  straight from the mapped file. hash covers every byte after the header.
+  Numbers are in the byte order of the machine that compiled the file.*/
+typedef struct {
+  char           magic[4];     // "LMDB"
+  uint32_t       version;
+  uint32_t       meshes_count;
+  uint32_t       reserved;
+  uint64_t       length;       // of the whole file
+  uint64_t       hash;
+} lgl_lmodb_header_t;
+
+/*bounds are those packed positions are relative to, see lgl_mesh_quantize*/
+typedef struct {
+  char           name[64];     // nul terminated, longer names are cut
+  lgl_bounds_t   bounds;
+  uint32_t       vertex_format;
+  uint32_t       vertex_count;
+  uint32_t       index_count;
+  uint32_t       levels_count;
+  lgl_lod_t      levels[LGL_LOD_MAX];
+  uint64_t       vertices_offset;
+  uint64_t       indices_offset;
+} lgl_lmodb_mesh_t;
+
+/*64-bit FNV-1a over 8 byte words, then the bytes left over*/
+uint64_t                lgl_lmod_hash     (const void *data, const size_t length);
+
+/*Writes meshes as an .lmodb file, with vertices in vertex_format. Returns 0
+  when the file could not be written.*/
+int                     lgl_lmodb_write   (FILE             *file,
+                                           const size_t      meshes_count,
+                                           const lgl_lmod_t *meshes,
+                                           const GLint       vertex_format);
+
+/*Checks the header of an .lmodb file in memory and that every section is
+  inside it. verify also checks the hash and that indices are in range,
+  which reads the whole file. Returns the mesh table, or NULL with the
+  problem logged.*/
+const lgl_lmodb_mesh_t *lgl_lmodb_validate(const void  *file,
+                                           const size_t length,
+                                           const int    verify);
+
+#ifdef __cplusplus
+}
+#endif // ifdef __cplusplus
+
+#endif // LGL_LMOD_H
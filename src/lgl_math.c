@@ -0,0 +1,525 @@
+#include "lgl_math.h"
+
+#if LGL_MATH_SSE2
+#include <immintrin.h>
+
+#if defined(__FMA__)
+#define LGL__MADD(a, b, c)    _mm_fmadd_ps   ((a), (b), (c))
+#define LGL__MADD256(a, b, c) _mm256_fmadd_ps((a), (b), (c))
+#else
+#define LGL__MADD(a, b, c)    _mm_add_ps   (_mm_mul_ps   ((a), (b)), (c))
+#define LGL__MADD256(a, b, c) _mm256_add_ps(_mm256_mul_ps((a), (b)), (c))
+#endif // defined(__FMA__)
+#endif // LGL_MATH_SSE2
+
+/*-- scalar kernels, the reference the vector paths must match -------------*/
+
+static inline void lgl__mat4_multiply_scalar(float *result, const float *a, const float *b) {
+  float r[16];
+  for(size_t column = 0; column < 4; column++) {
+    for(size_t row = 0; row < 4; row++) {
+      r[column * 4 + row] =
+        a[ 0 + row] * b[column * 4 + 0] +
+        a[ 4 + row] * b[column * 4 + 1] +
+        a[ 8 + row] * b[column * 4 + 2] +
+        a[12 + row] * b[column * 4 + 3];
+    }
+  }
+  memcpy(result, r, sizeof(r));
+}
+
+static inline lgl_4f_t lgl__mat4_transform_scalar(const float *m, const lgl_4f_t v) {
+  return (lgl_4f_t) {
+    m[0] * v.x + m[4] * v.y + m[ 8] * v.z + m[12] * v.w,
+    m[1] * v.x + m[5] * v.y + m[ 9] * v.z + m[13] * v.w,
+    m[2] * v.x + m[6] * v.y + m[10] * v.z + m[14] * v.w,
+    m[3] * v.x + m[7] * v.y + m[11] * v.z + m[15] * v.w,
+  };
+}
+
+/*The inverse transpose of a 3x3 is its cofactor matrix over its
+  determinant, and the cofactor columns are cross products of the columns*/
+static inline void lgl__mat3_inverse_transpose_scalar(float *result, const float *m) {
+  const float *c0 = &m[0], *c1 = &m[4], *c2 = &m[8];
+
+  const float r[12] = {
+    c1[1] * c2[2] - c1[2] * c2[1],
+    c1[2] * c2[0] - c1[0] * c2[2],
+    c1[0] * c2[1] - c1[1] * c2[0],
+    0,
+    c2[1] * c0[2] - c2[2] * c0[1],
+    c2[2] * c0[0] - c2[0] * c0[2],
+    c2[0] * c0[1] - c2[1] * c0[0],
+    0,
+    c0[1] * c1[2] - c0[2] * c1[1],
+    c0[2] * c1[0] - c0[0] * c1[2],
+    c0[0] * c1[1] - c0[1] * c1[0],
+    0,
+  };
+
+  const float determinant = c0[0] * r[0] + c0[1] * r[1] + c0[2] * r[2];
+  const float inverse     = determinant != 0 ? 1.0f / determinant : 0.0f;
+
+  for(size_t i = 0; i < 12; i++) {
+    result[i] = r[i] * inverse;
+  }
+}
+
+static inline void lgl__mat4_trs_scalar(
+    float          *model,
+    float          *normal,
+    const lgl_3f_t  position,
+    const lgl_4f_t  q,
+    const lgl_3f_t  scale) {
+
+  const float
+    xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z,
+    xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z,
+    wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+  const float rotation[9] = {
+    1 - 2 * (yy + zz),     2 * (xy + wz),     2 * (xz - wy),
+        2 * (xy - wz), 1 - 2 * (xx + zz),     2 * (yz + wx),
+        2 * (xz + wy),     2 * (yz - wx), 1 - 2 * (xx + yy),
+  };
+
+  const float s[3] = { scale.x, scale.y, scale.z };
+
+  for(size_t column = 0; column < 3; column++) {
+    for(size_t row = 0; row < 3; row++) {
+      model[column * 4 + row] = rotation[column * 3 + row] * s[column];
+    }
+    model[column * 4 + 3] = 0;
+  }
+
+  model[12] = position.x;
+  model[13] = position.y;
+  model[14] = position.z;
+  model[15] = 1;
+
+  // for a rotation and a scale the inverse transpose is the rotation with each
+  // column divided by its scale
+  if (normal) {
+    for(size_t column = 0; column < 3; column++) {
+      const float inverse = s[column] != 0 ? 1.0f / s[column] : 0.0f;
+      for(size_t row = 0; row < 3; row++) {
+        normal[column * 4 + row] = rotation[column * 3 + row] * inverse;
+      }
+      normal[column * 4 + 3] = 0;
+    }
+  }
+}
+
+/*-- SSE2 and AVX2 kernels -------------------------------------------------*/
+
+#if LGL_MATH_SSE2
+/*One column of a * b, with the columns of a already in registers*/
+static inline __m128 lgl__mat4_column(const __m128 *a, const float *b_column) {
+  __m128 r = _mm_mul_ps(a[0], _mm_set1_ps(b_column[0]));
+  r = LGL__MADD(a[1], _mm_set1_ps(b_column[1]), r);
+  r = LGL__MADD(a[2], _mm_set1_ps(b_column[2]), r);
+  r = LGL__MADD(a[3], _mm_set1_ps(b_column[3]), r);
+  return r;
+}
+
+#if LGL_MATH_AVX2
+/*Two columns of a * b at once. Each 128 bit lane holds one column, a holds
+  the columns of a repeated in both lanes.*/
+static inline __m256 lgl__mat4_column_pair(const __m256 *a, const float *b_columns) {
+  const __m256 b = _mm256_loadu_ps(b_columns);
+  __m256 r = _mm256_mul_ps(a[0], _mm256_permute_ps(b, 0x00));
+  r = LGL__MADD256(a[1], _mm256_permute_ps(b, 0x55), r);
+  r = LGL__MADD256(a[2], _mm256_permute_ps(b, 0xAA), r);
+  r = LGL__MADD256(a[3], _mm256_permute_ps(b, 0xFF), r);
+  return r;
+}
+
+static inline __m256 lgl__repeat_lanes(const __m128 v) {
+  return _mm256_insertf128_ps(_mm256_castps128_ps256(v), v, 1);
+}
+#endif // LGL_MATH_AVX2
+
+static inline __m128 lgl__cross(const __m128 a, const __m128 b) {
+  const __m128 a_yzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+  const __m128 b_yzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+  const __m128 c     = _mm_sub_ps(_mm_mul_ps(a, b_yzx), _mm_mul_ps(a_yzx, b));
+  return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+}
+
+static inline __m128 lgl__dot3(const __m128 a, const __m128 b) {
+  const __m128 p = _mm_mul_ps(a, b);
+  const __m128 x = _mm_shuffle_ps(p, p, _MM_SHUFFLE(0, 0, 0, 0));
+  const __m128 y = _mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 1, 1, 1));
+  const __m128 z = _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 2, 2));
+  return _mm_add_ps(_mm_add_ps(x, y), z);
+}
+
+static inline void lgl__mat3_inverse_transpose_sse2(float *result, const float *m) {
+  const __m128 w_mask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+  const __m128 c0 = _mm_and_ps(_mm_loadu_ps(&m[0]), w_mask);
+  const __m128 c1 = _mm_and_ps(_mm_loadu_ps(&m[4]), w_mask);
+  const __m128 c2 = _mm_and_ps(_mm_loadu_ps(&m[8]), w_mask);
+
+  const __m128 r0 = lgl__cross(c1, c2);
+  const __m128 r1 = lgl__cross(c2, c0);
+  const __m128 r2 = lgl__cross(c0, c1);
+
+  const __m128 determinant = lgl__dot3(c0, r0);
+  const __m128 nonzero     = _mm_cmpneq_ps(determinant, _mm_setzero_ps());
+  const __m128 inverse     = _mm_and_ps(_mm_div_ps(_mm_set1_ps(1.0f), determinant), nonzero);
+
+  _mm_storeu_ps(&result[0], _mm_mul_ps(r0, inverse));
+  _mm_storeu_ps(&result[4], _mm_mul_ps(r1, inverse));
+  _mm_storeu_ps(&result[8], _mm_mul_ps(r2, inverse));
+}
+
+/*Four TRS transforms at once. The inputs are transposed so each register
+  holds one component of four objects, and transposed back on the way out.*/
+static inline void lgl__mat4_trs_sse2(
+    float          *models,
+    float          *normals,
+    const lgl_3f_t *p,
+    const lgl_4f_t *q,
+    const lgl_3f_t *s) {
+
+  __m128 x = _mm_loadu_ps(&q[0].x);
+  __m128 y = _mm_loadu_ps(&q[1].x);
+  __m128 z = _mm_loadu_ps(&q[2].x);
+  __m128 w = _mm_loadu_ps(&q[3].x);
+  _MM_TRANSPOSE4_PS(x, y, z, w);
+
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 two = _mm_set1_ps(2.0f);
+
+  const __m128
+    xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z),
+    xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z),
+    wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+  const __m128 rotation[3][3] = {
+    {
+      _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))),
+      _mm_mul_ps(two, _mm_add_ps(xy, wz)),
+      _mm_mul_ps(two, _mm_sub_ps(xz, wy)),
+    }, {
+      _mm_mul_ps(two, _mm_sub_ps(xy, wz)),
+      _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))),
+      _mm_mul_ps(two, _mm_add_ps(yz, wx)),
+    }, {
+      _mm_mul_ps(two, _mm_add_ps(xz, wy)),
+      _mm_mul_ps(two, _mm_sub_ps(yz, wx)),
+      _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))),
+    },
+  };
+
+  const __m128 scale[3] = {
+    _mm_set_ps(s[3].x, s[2].x, s[1].x, s[0].x),
+    _mm_set_ps(s[3].y, s[2].y, s[1].y, s[0].y),
+    _mm_set_ps(s[3].z, s[2].z, s[1].z, s[0].z),
+  };
+
+  const __m128 zero = _mm_setzero_ps();
+
+  for(size_t column = 0; column < 3; column++) {
+    __m128 r0 = _mm_mul_ps(rotation[column][0], scale[column]);
+    __m128 r1 = _mm_mul_ps(rotation[column][1], scale[column]);
+    __m128 r2 = _mm_mul_ps(rotation[column][2], scale[column]);
+    __m128 r3 = zero;
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    _mm_storeu_ps(&models[ 0 + column * 4], r0);
+    _mm_storeu_ps(&models[16 + column * 4], r1);
+    _mm_storeu_ps(&models[32 + column * 4], r2);
+    _mm_storeu_ps(&models[48 + column * 4], r3);
+  }
+
+  {
+    __m128 t0 = _mm_set_ps(p[3].x, p[2].x, p[1].x, p[0].x);
+    __m128 t1 = _mm_set_ps(p[3].y, p[2].y, p[1].y, p[0].y);
+    __m128 t2 = _mm_set_ps(p[3].z, p[2].z, p[1].z, p[0].z);
+    __m128 t3 = one;
+    _MM_TRANSPOSE4_PS(t0, t1, t2, t3);
+    _mm_storeu_ps(&models[12], t0);
+    _mm_storeu_ps(&models[28], t1);
+    _mm_storeu_ps(&models[44], t2);
+    _mm_storeu_ps(&models[60], t3);
+  }
+
+  if (normals == NULL) {
+    return;
+  }
+
+  for(size_t column = 0; column < 3; column++) {
+    const __m128 nonzero = _mm_cmpneq_ps(scale[column], zero);
+    const __m128 inverse = _mm_and_ps(_mm_div_ps(one, scale[column]), nonzero);
+
+    __m128 r0 = _mm_mul_ps(rotation[column][0], inverse);
+    __m128 r1 = _mm_mul_ps(rotation[column][1], inverse);
+    __m128 r2 = _mm_mul_ps(rotation[column][2], inverse);
+    __m128 r3 = zero;
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    _mm_storeu_ps(&normals[ 0 + column * 4], r0);
+    _mm_storeu_ps(&normals[12 + column * 4], r1);
+    _mm_storeu_ps(&normals[24 + column * 4], r2);
+    _mm_storeu_ps(&normals[36 + column * 4], r3);
+  }
+}
+#endif // LGL_MATH_SSE2
+
+/*-- public entry points ---------------------------------------------------*/
+
+void lgl_mat4_multiply(float *result, const float *a, const float *b) {
+#if LGL_MATH_AVX2
+  const __m256 columns[4] = {
+    lgl__repeat_lanes(_mm_loadu_ps(&a[ 0])),
+    lgl__repeat_lanes(_mm_loadu_ps(&a[ 4])),
+    lgl__repeat_lanes(_mm_loadu_ps(&a[ 8])),
+    lgl__repeat_lanes(_mm_loadu_ps(&a[12])),
+  };
+  const __m256 r01 = lgl__mat4_column_pair(columns, &b[0]);
+  const __m256 r23 = lgl__mat4_column_pair(columns, &b[8]);
+  _mm256_storeu_ps(&result[0], r01);
+  _mm256_storeu_ps(&result[8], r23);
+#elif LGL_MATH_SSE2
+  const __m128 columns[4] = {
+    _mm_loadu_ps(&a[ 0]), _mm_loadu_ps(&a[ 4]),
+    _mm_loadu_ps(&a[ 8]), _mm_loadu_ps(&a[12]),
+  };
+  const __m128 r0 = lgl__mat4_column(columns, &b[ 0]);
+  const __m128 r1 = lgl__mat4_column(columns, &b[ 4]);
+  const __m128 r2 = lgl__mat4_column(columns, &b[ 8]);
+  const __m128 r3 = lgl__mat4_column(columns, &b[12]);
+  _mm_storeu_ps(&result[ 0], r0);
+  _mm_storeu_ps(&result[ 4], r1);
+  _mm_storeu_ps(&result[ 8], r2);
+  _mm_storeu_ps(&result[12], r3);
+#else
+  lgl__mat4_multiply_scalar(result, a, b);
+#endif
+}
+
+void lgl_mat4_multiply_batch(
+    const size_t count,
+    float       *results,
+    const float *a,
+    const float *b) {
+#if LGL_MATH_AVX2
+  const __m256 columns[4] = {
+    lgl__repeat_lanes(_mm_loadu_ps(&a[ 0])),
+    lgl__repeat_lanes(_mm_loadu_ps(&a[ 4])),
+    lgl__repeat_lanes(_mm_loadu_ps(&a[ 8])),
+    lgl__repeat_lanes(_mm_loadu_ps(&a[12])),
+  };
+  for(size_t i = 0; i < count; i++) {
+    const __m256 r01 = lgl__mat4_column_pair(columns, &b[i * 16 + 0]);
+    const __m256 r23 = lgl__mat4_column_pair(columns, &b[i * 16 + 8]);
+    _mm256_storeu_ps(&results[i * 16 + 0], r01);
+    _mm256_storeu_ps(&results[i * 16 + 8], r23);
+  }
+#elif LGL_MATH_SSE2
+  const __m128 columns[4] = {
+    _mm_loadu_ps(&a[ 0]), _mm_loadu_ps(&a[ 4]),
+    _mm_loadu_ps(&a[ 8]), _mm_loadu_ps(&a[12]),
+  };
+  for(size_t i = 0; i < count; i++) {
+    const __m128 r0 = lgl__mat4_column(columns, &b[i * 16 +  0]);
+    const __m128 r1 = lgl__mat4_column(columns, &b[i * 16 +  4]);
+    const __m128 r2 = lgl__mat4_column(columns, &b[i * 16 +  8]);
+    const __m128 r3 = lgl__mat4_column(columns, &b[i * 16 + 12]);
+    _mm_storeu_ps(&results[i * 16 +  0], r0);
+    _mm_storeu_ps(&results[i * 16 +  4], r1);
+    _mm_storeu_ps(&results[i * 16 +  8], r2);
+    _mm_storeu_ps(&results[i * 16 + 12], r3);
+  }
+#else
+  float a_copy[16];
+  memcpy(a_copy, a, sizeof(a_copy)); // results may alias a
+  for(size_t i = 0; i < count; i++) {
+    lgl__mat4_multiply_scalar(&results[i * 16], a_copy, &b[i * 16]);
+  }
+#endif
+}
+
+lgl_4f_t lgl_mat4_transform(const float *m, const lgl_4f_t v) {
+#if LGL_MATH_SSE2
+  const __m128 columns[4] = {
+    _mm_loadu_ps(&m[ 0]), _mm_loadu_ps(&m[ 4]),
+    _mm_loadu_ps(&m[ 8]), _mm_loadu_ps(&m[12]),
+  };
+  lgl_4f_t result;
+  _mm_storeu_ps(&result.x, lgl__mat4_column(columns, &v.x));
+  return result;
+#else
+  return lgl__mat4_transform_scalar(m, v);
+#endif
+}
+
+void lgl_mat4_transform_batch(
+    const size_t    count,
+    lgl_4f_t       *results,
+    const float    *m,
+    const lgl_4f_t *v) {
+#if LGL_MATH_SSE2
+  const __m128 columns[4] = {
+    _mm_loadu_ps(&m[ 0]), _mm_loadu_ps(&m[ 4]),
+    _mm_loadu_ps(&m[ 8]), _mm_loadu_ps(&m[12]),
+  };
+  for(size_t i = 0; i < count; i++) {
+    _mm_storeu_ps(&results[i].x, lgl__mat4_column(columns, &v[i].x));
+  }
+#else
+  float m_copy[16];
+  memcpy(m_copy, m, sizeof(m_copy));
+  for(size_t i = 0; i < count; i++) {
+    results[i] = lgl__mat4_transform_scalar(m_copy, v[i]);
+  }
+#endif
+}
+
+void lgl_mat3_inverse_transpose(float *result, const float *m) {
+#if LGL_MATH_SSE2
+  lgl__mat3_inverse_transpose_sse2(result, m);
+#else
+  lgl__mat3_inverse_transpose_scalar(result, m);
+#endif
+}
+
+void lgl_mat3_inverse_transpose_batch(
+    const size_t count,
+    float       *results,
+    const float *m) {
+  for(size_t i = 0; i < count; i++) {
+#if LGL_MATH_SSE2
+    lgl__mat3_inverse_transpose_sse2(&results[i * 12], &m[i * 16]);
+#else
+    lgl__mat3_inverse_transpose_scalar(&results[i * 12], &m[i * 16]);
+#endif
+  }
+}
+
+void lgl_mat4_trs(
+    float          *model,
+    float          *normal,
+    const lgl_3f_t  position,
+    const lgl_4f_t  rotation,
+    const lgl_3f_t  scale) {
+  lgl__mat4_trs_scalar(model, normal, position, rotation, scale);
+}
+
+void lgl_mat4_trs_batch(
+    const size_t    count,
+    float          *models,
+    float          *normals,
+    const lgl_3f_t *positions,
+    const lgl_4f_t *rotations,
+    const lgl_3f_t *scales) {
+  size_t i = 0;
+
+#if LGL_MATH_SSE2
+  for(; i + 4 <= count; i += 4) {
+    lgl__mat4_trs_sse2(&models[i * 16], normals ? &normals[i * 12] : NULL,
+        &positions[i], &rotations[i], &scales[i]);
+  }
+#endif // LGL_MATH_SSE2
+
+  for(; i < count; i++) {
+    lgl__mat4_trs_scalar(&models[i * 16], normals ? &normals[i * 12] : NULL,
+        positions[i], rotations[i], scales[i]);
+  }
+}
+
+/*-- scalar references -----------------------------------------------------*/
+
+void lgl_mat4_multiply_scalar(float *result, const float *a, const float *b) {
+  lgl__mat4_multiply_scalar(result, a, b);
+}
+
+lgl_4f_t lgl_mat4_transform_scalar(const float *m, const lgl_4f_t v) {
+  return lgl__mat4_transform_scalar(m, v);
+}
+
+void lgl_mat3_inverse_transpose_scalar(float *result, const float *m) {
+  lgl__mat3_inverse_transpose_scalar(result, m);
+}
+
+void lgl_mat4_trs_scalar(
+    float          *model,
+    float          *normal,
+    const lgl_3f_t  position,
+    const lgl_4f_t  rotation,
+    const lgl_3f_t  scale) {
+  lgl__mat4_trs_scalar(model, normal, position, rotation, scale);
+}
+
+void lgl_frustum_planes(lgl_4f_t *planes, const float *m) {
+  // Gribb and Hartmann, each plane is the last row plus or minus another
+  for(size_t i = 0; i < 6; i++) {
+    const size_t row  = i / 2;
+    const float  sign = (i % 2) ? -1.0f : 1.0f;
+
+    lgl_4f_t plane = {
+      m[ 3] + sign * m[ 0 + row],
+      m[ 7] + sign * m[ 4 + row],
+      m[11] + sign * m[ 8 + row],
+      m[15] + sign * m[12 + row],
+    };
+
+    const float length = sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+    if (length > 0) {
+      plane.x /= length;
+      plane.y /= length;
+      plane.z /= length;
+      plane.w /= length;
+    }
+    planes[i] = plane;
+  }
+}
+
+static inline uint8_t lgl__frustum_test_sphere(const lgl_4f_t *planes, const lgl_4f_t sphere) {
+  for(size_t i = 0; i < 6; i++) {
+    const lgl_4f_t p = planes[i];
+    if (p.x * sphere.x + p.y * sphere.y + p.z * sphere.z + p.w < -sphere.w) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+void lgl_frustum_test_spheres(
+    const size_t    count,
+    uint8_t        *visible,
+    const lgl_4f_t *planes,
+    const lgl_4f_t *spheres) {
+  size_t i = 0;
+
+#if LGL_MATH_SSE2
+  // four spheres at a time, transposed so each register holds one component
+  for(; i + 4 <= count; i += 4) {
+    __m128 x = _mm_loadu_ps(&spheres[i + 0].x);
+    __m128 y = _mm_loadu_ps(&spheres[i + 1].x);
+    __m128 z = _mm_loadu_ps(&spheres[i + 2].x);
+    __m128 r = _mm_loadu_ps(&spheres[i + 3].x);
+    _MM_TRANSPOSE4_PS(x, y, z, r);
+
+    const __m128 negative_r = _mm_sub_ps(_mm_setzero_ps(), r);
+
+    __m128 outside = _mm_setzero_ps();
+    for(size_t plane = 0; plane < 6; plane++) {
+      __m128 d = _mm_set1_ps(planes[plane].w);
+      d = LGL__MADD(x, _mm_set1_ps(planes[plane].x), d);
+      d = LGL__MADD(y, _mm_set1_ps(planes[plane].y), d);
+      d = LGL__MADD(z, _mm_set1_ps(planes[plane].z), d);
+      outside = _mm_or_ps(outside, _mm_cmplt_ps(d, negative_r));
+    }
+
+    const int mask = _mm_movemask_ps(outside);
+    visible[i + 0] = !(mask & 1);
+    visible[i + 1] = !(mask & 2);
+    visible[i + 2] = !(mask & 4);
+    visible[i + 3] = !(mask & 8);
+  }
+#endif // LGL_MATH_SSE2
+
+  for(; i < count; i++) {
+    visible[i] = lgl__frustum_test_sphere(planes, spheres[i]);
+  }
+}
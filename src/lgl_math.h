@@ -0,0 +1,117 @@
+/*--------------------------------------------------------------------------/
+/                                                                           /
+/ lgl_math.h                                                                /
+/ Matrix and vector kernels for lgl                                         /
+/                                                                           /
+/--------------------------------------------------------------------------*/
+
+#ifndef LGL_MATH_H
+#define LGL_MATH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif // ifdef __cplusplus
+
+#include "lgl.h"
+
+/*The kernels are picked at build time from the instruction sets the compiler
+  targets. Build with -mavx2 (and -mfma) for the AVX2 paths, or with
+  -DLGL_MATH_SCALAR=1 to force the portable ones.*/
+#ifndef LGL_MATH_SCALAR
+#define LGL_MATH_SCALAR 0
+#endif // ifndef LGL_MATH_SCALAR
+
+#if !LGL_MATH_SCALAR && defined(__SSE2__)
+#define LGL_MATH_SSE2 1
+#else
+#define LGL_MATH_SSE2 0
+#endif // SSE2
+
+#if LGL_MATH_SSE2 && defined(__AVX2__)
+#define LGL_MATH_AVX2 1
+#else
+#define LGL_MATH_AVX2 0
+#endif // AVX2
+
+#if LGL_MATH_AVX2
+#define LGL_MATH_BACKEND "avx2"
+#elif LGL_MATH_SSE2
+#define LGL_MATH_BACKEND "sse2"
+#else
+#define LGL_MATH_BACKEND "scalar"
+#endif
+
+/*All matrices are column-major float arrays, the layout GL expects. A 4x4
+  matrix is 16 floats. A normal matrix is a 3x3 stored as three vec4 columns,
+  12 floats, the std140/std430 layout of a mat3. Results may alias inputs
+  unless noted otherwise.*/
+
+/*result = a * b*/
+void     lgl_mat4_multiply       (float *result, const float *a, const float *b);
+
+/*results[i] = a * b[i] for count matrices stored back to back*/
+void     lgl_mat4_multiply_batch (const size_t count,
+                                  float       *results,
+                                  const float *a,
+                                  const float *b);
+
+/*m * v*/
+lgl_4f_t lgl_mat4_transform      (const float *m, const lgl_4f_t v);
+
+/*results[i] = m * v[i]*/
+void     lgl_mat4_transform_batch(const size_t    count,
+                                  lgl_4f_t       *results,
+                                  const float    *m,
+                                  const lgl_4f_t *v);
+
+/*The inverse transpose of the upper 3x3 of a 4x4 matrix, written as a normal
+  matrix. A singular matrix gives all zeroes.*/
+void     lgl_mat3_inverse_transpose      (float *result, const float *m);
+void     lgl_mat3_inverse_transpose_batch(const size_t count,
+                                          float       *results,
+                                          const float *m);
+
+/*translation * rotation * scale, from a unit quaternion rotation. normal
+  receives the matching normal matrix and may be NULL.*/
+void     lgl_mat4_trs            (float          *model,
+                                  float          *normal,
+                                  const lgl_3f_t  position,
+                                  const lgl_4f_t  rotation,
+                                  const lgl_3f_t  scale);
+
+/*lgl_mat4_trs over count transforms. normals may be NULL.*/
+void     lgl_mat4_trs_batch      (const size_t    count,
+                                  float          *models,
+                                  float          *normals,
+                                  const lgl_3f_t *positions,
+                                  const lgl_4f_t *rotations,
+                                  const lgl_3f_t *scales);
+
+/*The portable kernels, built whatever the backend so tools/math_test.c can
+  check and time the vector paths against them*/
+void     lgl_mat4_multiply_scalar         (float *result, const float *a, const float *b);
+lgl_4f_t lgl_mat4_transform_scalar        (const float *m, const lgl_4f_t v);
+void     lgl_mat3_inverse_transpose_scalar(float *result, const float *m);
+void     lgl_mat4_trs_scalar              (float          *model,
+                                           float          *normal,
+                                           const lgl_3f_t  position,
+                                           const lgl_4f_t  rotation,
+                                           const lgl_3f_t  scale);
+
+/*The six planes of a view-projection's frustum, as (normal, distance) with
+  normals pointing inwards and normalized, in the order left, right,
+  bottom, top, near, far*/
+void     lgl_frustum_planes      (lgl_4f_t *planes, const float *view_projection);
+
+/*visible[i] is 0 when sphere i, center in xyz and radius in w, is fully
+  outside one of the six planes and 1 otherwise*/
+void     lgl_frustum_test_spheres(const size_t    count,
+                                  uint8_t        *visible,
+                                  const lgl_4f_t *planes,
+                                  const lgl_4f_t *spheres);
+
+#ifdef __cplusplus
+}
+#endif // ifdef __cplusplus
+
+#endif // LGL_MATH_H
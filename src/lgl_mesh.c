@@ -0,0 +1,856 @@
+#include "lgl_mesh.h"
+
+/*-- welding ---------------------------------------------------------------*/
+
+static inline uint32_t lgl__mesh_hash(const lgl_vertex_t *vertex) {
+  const unsigned char *bytes = (const unsigned char*)vertex;
+
+  uint32_t hash = 2166136261u; // FNV-1a
+  for(size_t i = 0; i < sizeof(*vertex); i++) {
+    hash = (hash ^ bytes[i]) * 16777619u;
+  }
+  return hash;
+}
+
+size_t lgl_mesh_weld(
+    const size_t        vertex_count,
+    const lgl_vertex_t *vertices,
+    lgl_vertex_t       *unique,
+    uint32_t           *indices) {
+
+  // open addressing, kept at most half full
+  size_t table_size = 64;
+  while (table_size < vertex_count * 2) {
+    table_size *= 2;
+  }
+
+  uint32_t *table = malloc(table_size * sizeof(*table));
+  memset(table, 0xFF, table_size * sizeof(*table));
+
+  size_t unique_count = 0;
+  for(size_t i = 0; i < vertex_count; i++) {
+    size_t slot = lgl__mesh_hash(&vertices[i]) & (table_size - 1);
+
+    while (table[slot] != UINT32_MAX &&
+        memcmp(&unique[table[slot]], &vertices[i], sizeof(*vertices)) != 0) {
+      slot = (slot + 1) & (table_size - 1);
+    }
+
+    if (table[slot] == UINT32_MAX) {
+      table[slot]            = unique_count;
+      unique[unique_count++] = vertices[i];
+    }
+    indices[i] = table[slot];
+  }
+
+  free(table);
+  return unique_count;
+}
+
+/*-- bounds ----------------------------------------------------------------*/
+
+lgl_bounds_t lgl_bounds_compute(const size_t vertex_count, const lgl_vertex_t *vertices) {
+  lgl_bounds_t bounds = {0};
+  if (vertex_count == 0) {
+    return bounds;
+  }
+
+  bounds.min = bounds.max = vertices[0].position;
+  for(size_t i = 1; i < vertex_count; i++) {
+    const lgl_3f_t p = vertices[i].position;
+    bounds.min.x = fminf(bounds.min.x, p.x); bounds.max.x = fmaxf(bounds.max.x, p.x);
+    bounds.min.y = fminf(bounds.min.y, p.y); bounds.max.y = fmaxf(bounds.max.y, p.y);
+    bounds.min.z = fminf(bounds.min.z, p.z); bounds.max.z = fmaxf(bounds.max.z, p.z);
+  }
+
+  // the sphere is centered on the box but only as large as the vertices need
+  bounds.center = (lgl_3f_t) {
+    (bounds.min.x + bounds.max.x) * 0.5f,
+    (bounds.min.y + bounds.max.y) * 0.5f,
+    (bounds.min.z + bounds.max.z) * 0.5f,
+  };
+
+  float radius_squared = 0;
+  for(size_t i = 0; i < vertex_count; i++) {
+    const float
+      x = vertices[i].position.x - bounds.center.x,
+      y = vertices[i].position.y - bounds.center.y,
+      z = vertices[i].position.z - bounds.center.z;
+    radius_squared = fmaxf(radius_squared, x * x + y * y + z * z);
+  }
+  bounds.radius = sqrtf(radius_squared);
+
+  return bounds;
+}
+
+/*-- vertex cache optimization ---------------------------------------------*/
+
+/*Scores from the paper. Vertices of the last triangle get a fixed score so
+  the next triangle does not simply reuse them in the same order, the rest of
+  the cache decays with position, and vertices with few triangles left get a
+  boost so they are finished off instead of being left stranded.*/
+static const float
+  LGL__FORSYTH_DECAY_POWER   = 1.5f,
+  LGL__FORSYTH_LAST_TRIANGLE = 0.75f,
+  LGL__FORSYTH_VALENCE_SCALE = 2.0f,
+  LGL__FORSYTH_VALENCE_POWER = 0.5f;
+
+enum { LGL__FORSYTH_VALENCE_MAX = 32 }; // valence scores past this are computed
+
+typedef struct {
+  float          cache[LGL_MESH_CACHE_SIZE];
+  float          valence[LGL__FORSYTH_VALENCE_MAX];
+} lgl__forsyth_scores_t;
+
+static inline float lgl__forsyth_score(
+    const lgl__forsyth_scores_t *scores,
+    const int                    cache_position,
+    const uint32_t               active) {
+  if (active == 0) {
+    return -1; // no triangles left to draw
+  }
+
+  float score = cache_position >= 0 ? scores->cache[cache_position] : 0;
+  if (active < LGL__FORSYTH_VALENCE_MAX) {
+    score += scores->valence[active];
+  } else {
+    score += LGL__FORSYTH_VALENCE_SCALE * powf(active, -LGL__FORSYTH_VALENCE_POWER);
+  }
+  return score;
+}
+
+void lgl_mesh_optimize_cache(
+    const size_t index_count,
+    uint32_t    *indices,
+    const size_t vertex_count) {
+
+  const size_t triangle_count = index_count / 3;
+  if (triangle_count < 2) {
+    return;
+  }
+
+  lgl__forsyth_scores_t scores; {
+    for(int i = 0; i < LGL_MESH_CACHE_SIZE; i++) {
+      scores.cache[i] = i < 3 ? LGL__FORSYTH_LAST_TRIANGLE :
+        powf(1.0f - (i - 3) / (float)(LGL_MESH_CACHE_SIZE - 3), LGL__FORSYTH_DECAY_POWER);
+    }
+    scores.valence[0] = 0;
+    for(int i = 1; i < LGL__FORSYTH_VALENCE_MAX; i++) {
+      scores.valence[i] = LGL__FORSYTH_VALENCE_SCALE * powf(i, -LGL__FORSYTH_VALENCE_POWER);
+    }
+  }
+
+  uint32_t *active          = calloc(vertex_count,      sizeof(*active));
+  uint32_t *offsets         = calloc(vertex_count + 1,  sizeof(*offsets));
+  uint32_t *adjacency       = calloc(triangle_count * 3, sizeof(*adjacency));
+  int      *cache_positions = malloc(vertex_count       * sizeof(*cache_positions));
+  float    *vertex_scores   = malloc(vertex_count       * sizeof(*vertex_scores));
+  float    *triangle_scores = malloc(triangle_count     * sizeof(*triangle_scores));
+  uint8_t  *emitted         = calloc(triangle_count,     sizeof(*emitted));
+  uint32_t *output          = malloc(triangle_count * 3 * sizeof(*output));
+
+  // triangles of each vertex, as ranges of one adjacency array
+  for(size_t i = 0; i < triangle_count * 3; i++) {
+    active[indices[i]]++;
+  }
+  for(size_t v = 0; v < vertex_count; v++) {
+    offsets[v + 1] = offsets[v] + active[v];
+  }
+  {
+    uint32_t *fill = calloc(vertex_count, sizeof(*fill));
+    for(size_t i = 0; i < triangle_count * 3; i++) {
+      const uint32_t v = indices[i];
+      adjacency[offsets[v] + fill[v]++] = i / 3;
+    }
+    free(fill);
+  }
+
+  for(size_t v = 0; v < vertex_count; v++) {
+    cache_positions[v] = -1;
+    vertex_scores[v]   = lgl__forsyth_score(&scores, -1, active[v]);
+  }
+
+  size_t best = 0;
+  for(size_t t = 0; t < triangle_count; t++) {
+    const uint32_t *triangle = &indices[t * 3];
+    triangle_scores[t] =
+      vertex_scores[triangle[0]] + vertex_scores[triangle[1]] + vertex_scores[triangle[2]];
+    if (triangle_scores[t] > triangle_scores[best]) {
+      best = t;
+    }
+  }
+
+  // one spare slot per vertex of the new triangle, pushed out on the next step
+  uint32_t cache[LGL_MESH_CACHE_SIZE + 3];
+  size_t   cache_count = 0;
+  size_t   cursor      = 0; // no triangle before it is left
+
+  for(size_t out = 0; out < triangle_count; out++) {
+    if (best == SIZE_MAX) {
+      // nothing in the cache has triangles left, go on in input order
+      while (emitted[cursor]) {
+        cursor++;
+      }
+      best = cursor;
+    }
+
+    const uint32_t *triangle = &indices[best * 3];
+    memcpy(&output[out * 3], triangle, 3 * sizeof(*triangle));
+    emitted[best] = 1;
+
+    for(int i = 0; i < 3; i++) {
+      const uint32_t v = triangle[i];
+
+      uint32_t *list = &adjacency[offsets[v]];
+      for(uint32_t j = 0; j < active[v]; j++) {
+        if (list[j] == best) {
+          list[j] = list[--active[v]];
+          break;
+        }
+      }
+    }
+
+    // the triangle's vertices move to the front, the rest keep their order
+    uint32_t new_cache[LGL_MESH_CACHE_SIZE + 3];
+    size_t   new_count = 0;
+    for(int i = 0; i < 3; i++) {
+      const uint32_t v = triangle[i];
+      if ((i < 1 || triangle[0] != v) && (i < 2 || triangle[1] != v)) {
+        new_cache[new_count++] = v; // degenerate triangles add a vertex once
+      }
+    }
+    for(size_t i = 0; i < cache_count; i++) {
+      const uint32_t v = cache[i];
+      if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+        new_cache[new_count++] = v;
+      }
+    }
+
+    for(size_t i = 0; i < new_count; i++) {
+      const uint32_t v = new_cache[i];
+      cache_positions[v] = i < LGL_MESH_CACHE_SIZE ? (int)i : -1;
+      vertex_scores[v]   = lgl__forsyth_score(&scores, cache_positions[v], active[v]);
+    }
+
+    // only triangles touching the cache changed score, the best is among them
+    best = SIZE_MAX;
+    float best_score = -1;
+    for(size_t i = 0; i < new_count; i++) {
+      const uint32_t  v    = new_cache[i];
+      const uint32_t *list = &adjacency[offsets[v]];
+      for(uint32_t j = 0; j < active[v]; j++) {
+        const uint32_t  t     = list[j];
+        const uint32_t *other = &indices[t * 3];
+        triangle_scores[t] =
+          vertex_scores[other[0]] + vertex_scores[other[1]] + vertex_scores[other[2]];
+        if (triangle_scores[t] > best_score) {
+          best_score = triangle_scores[t];
+          best       = t;
+        }
+      }
+    }
+
+    cache_count = new_count < LGL_MESH_CACHE_SIZE ? new_count : LGL_MESH_CACHE_SIZE;
+    memcpy(cache, new_cache, cache_count * sizeof(*cache));
+  }
+
+  memcpy(indices, output, triangle_count * 3 * sizeof(*indices));
+
+  free(active);
+  free(offsets);
+  free(adjacency);
+  free(cache_positions);
+  free(vertex_scores);
+  free(triangle_scores);
+  free(emitted);
+  free(output);
+}
+
+/*-- quantization ----------------------------------------------------------*/
+
+/*IEEE half float, rounded to nearest even*/
+static inline uint16_t lgl__mesh_half(const float value) {
+  union { float f; uint32_t u; } bits = { value };
+
+  const uint32_t sign     = (bits.u >> 16) & 0x8000;
+  const int32_t  exponent = (int32_t)((bits.u >> 23) & 0xFF) - 127 + 15;
+  uint32_t       mantissa = bits.u & 0x7FFFFF;
+
+  if (((bits.u >> 23) & 0xFF) == 0xFF) {
+    return sign | 0x7C00 | (mantissa ? 0x200 : 0); // infinity or NaN
+  }
+  if (exponent >= 31) {
+    return sign | 0x7C00; // too large, infinity
+  }
+
+  int shift = 13;
+  if (exponent <= 0) {
+    if (exponent < -10) {
+      return sign; // too small, zero
+    }
+    mantissa |= 0x800000; // subnormal, the implicit bit becomes explicit
+    shift     = 14 - exponent;
+  }
+
+  uint32_t half = (exponent > 0 ? (uint32_t)exponent << 10 : 0) | (mantissa >> shift);
+
+  const uint32_t rest    = mantissa & ((1u << shift) - 1);
+  const uint32_t halfway = 1u << (shift - 1);
+  if (rest > halfway || (rest == halfway && (half & 1))) {
+    half++; // a carry into the exponent is still the right result
+  }
+  return sign | half;
+}
+
+static inline uint32_t lgl__mesh_snorm10(const float value) {
+  const float clamped = value < -1 ? -1 : value > 1 ? 1 : value;
+  return (uint32_t)(int32_t)lrintf(clamped * 511.0f) & 0x3FF;
+}
+
+static inline uint16_t lgl__mesh_unorm16(const float value, const float min, const float extent) {
+  if (extent <= 0) {
+    return 0;
+  }
+  const float t = (value - min) / extent;
+  return lrintf((t < 0 ? 0 : t > 1 ? 1 : t) * 65535.0f);
+}
+
+void lgl_mesh_quantize(
+    const size_t         vertex_count,
+    const lgl_vertex_t  *vertices,
+    const lgl_bounds_t  *bounds,
+    lgl_vertex_packed_t *packed) {
+
+  const lgl_3f_t min    = bounds->min;
+  const lgl_3f_t extent = {
+    bounds->max.x - min.x,
+    bounds->max.y - min.y,
+    bounds->max.z - min.z,
+  };
+
+  for(size_t i = 0; i < vertex_count; i++) {
+    const lgl_vertex_t *v = &vertices[i];
+
+    packed[i] = (lgl_vertex_packed_t) {
+      .position = {
+        lgl__mesh_unorm16(v->position.x, min.x, extent.x),
+        lgl__mesh_unorm16(v->position.y, min.y, extent.y),
+        lgl__mesh_unorm16(v->position.z, min.z, extent.z),
+        0,
+      },
+      .normal =
+        lgl__mesh_snorm10(v->normal.x)       |
+        lgl__mesh_snorm10(v->normal.y) << 10 |
+        lgl__mesh_snorm10(v->normal.z) << 20,
+      .texture_coordinates = {
+        lgl__mesh_half(v->texture_coordinates.x),
+        lgl__mesh_half(v->texture_coordinates.y),
+      },
+    };
+  }
+}
+
+/*-- analysis --------------------------------------------------------------*/
+
+/*FIFO cache simulation. A vertex is in the cache while fewer than
+  LGL_MESH_CACHE_SIZE misses happened since it was loaded. Flushing moves
+  the clock past every entry.*/
+typedef struct {
+  uint32_t      *loaded;
+  uint32_t       clock;
+} lgl__mesh_fifo_t;
+
+static inline void lgl__mesh_fifo_flush(lgl__mesh_fifo_t *fifo) {
+  fifo->clock += LGL_MESH_CACHE_SIZE + 1;
+}
+
+static inline uint32_t lgl__mesh_fifo_triangle(lgl__mesh_fifo_t *fifo, const uint32_t *triangle) {
+  uint32_t misses = 0;
+  for(int i = 0; i < 3; i++) {
+    if (fifo->clock - fifo->loaded[triangle[i]] > LGL_MESH_CACHE_SIZE) {
+      fifo->loaded[triangle[i]] = fifo->clock++;
+      misses++;
+    }
+  }
+  return misses;
+}
+
+float lgl_mesh_acmr(
+    const size_t    index_count,
+    const uint32_t *indices,
+    const size_t    vertex_count) {
+  const size_t triangle_count = index_count / 3;
+  if (triangle_count == 0) {
+    return 0;
+  }
+
+  lgl__mesh_fifo_t fifo = { calloc(vertex_count, sizeof(*fifo.loaded)), 0 };
+  lgl__mesh_fifo_flush(&fifo);
+
+  size_t misses = 0;
+  for(size_t t = 0; t < triangle_count; t++) {
+    misses += lgl__mesh_fifo_triangle(&fifo, &indices[t * 3]);
+  }
+
+  free(fifo.loaded);
+  return misses / (float)triangle_count;
+}
+
+/*-- overdraw --------------------------------------------------------------*/
+
+typedef struct {
+  float          key;
+  uint32_t       first;        // first triangle
+  uint32_t       count;
+} lgl__mesh_cluster_t;
+
+static int lgl__mesh_cluster_compare(const void *a, const void *b) {
+  const float
+    ka = ((const lgl__mesh_cluster_t*)a)->key,
+    kb = ((const lgl__mesh_cluster_t*)b)->key;
+  return (ka < kb) - (ka > kb); // largest key first
+}
+
+static inline lgl_3f_t lgl__mesh_triangle_normal(const lgl_vertex_t *vertices, const uint32_t *triangle) {
+  const lgl_3f_t
+    p0 = vertices[triangle[0]].position,
+    p1 = vertices[triangle[1]].position,
+    p2 = vertices[triangle[2]].position;
+  const lgl_3f_t
+    e1 = { p1.x - p0.x, p1.y - p0.y, p1.z - p0.z },
+    e2 = { p2.x - p0.x, p2.y - p0.y, p2.z - p0.z };
+  return (lgl_3f_t) { // twice the area long
+    e1.y * e2.z - e1.z * e2.y,
+    e1.z * e2.x - e1.x * e2.z,
+    e1.x * e2.y - e1.y * e2.x,
+  };
+}
+
+void lgl_mesh_optimize_overdraw(
+    const size_t        index_count,
+    uint32_t           *indices,
+    const size_t        vertex_count,
+    const lgl_vertex_t *vertices,
+    const float         threshold) {
+
+  const size_t triangle_count = index_count / 3;
+  if (triangle_count < 2) {
+    return;
+  }
+
+  const float acmr = lgl_mesh_acmr(index_count, indices, vertex_count);
+
+  lgl__mesh_cluster_t *clusters = malloc(triangle_count * sizeof(*clusters));
+  size_t               clusters_count = 0;
+
+  // every cluster starts cold, it may be drawn after any other
+  lgl__mesh_fifo_t fifo = { calloc(vertex_count, sizeof(*fifo.loaded)), 0 };
+  lgl__mesh_fifo_flush(&fifo);
+
+  size_t first = 0, misses = 0;
+  for(size_t t = 0; t < triangle_count; t++) {
+    misses += lgl__mesh_fifo_triangle(&fifo, &indices[t * 3]);
+
+    const size_t count = t + 1 - first;
+    if (misses <= threshold * acmr * count || t + 1 == triangle_count) {
+      clusters[clusters_count++] = (lgl__mesh_cluster_t) { 0, first, count };
+      lgl__mesh_fifo_flush(&fifo);
+      first  = t + 1;
+      misses = 0;
+    }
+  }
+  free(fifo.loaded);
+
+  if (clusters_count > 1) {
+    // area weighted centroids, of each cluster and of the whole mesh
+    lgl_3f_t *centroids = malloc(clusters_count * sizeof(*centroids));
+    lgl_3f_t *normals   = malloc(clusters_count * sizeof(*normals));
+    lgl_3f_t  center    = {0};
+    float     area      = 0;
+
+    for(size_t c = 0; c < clusters_count; c++) {
+      lgl_3f_t centroid = {0}, normal = {0};
+      float    cluster_area = 0;
+
+      for(size_t t = clusters[c].first; t < clusters[c].first + clusters[c].count; t++) {
+        const uint32_t *triangle = &indices[t * 3];
+        const lgl_3f_t  n        = lgl__mesh_triangle_normal(vertices, triangle);
+        const float     w        = sqrtf(n.x * n.x + n.y * n.y + n.z * n.z);
+
+        for(int i = 0; i < 3; i++) {
+          const lgl_3f_t p = vertices[triangle[i]].position;
+          centroid.x += p.x * w; centroid.y += p.y * w; centroid.z += p.z * w;
+        }
+        normal.x += n.x; normal.y += n.y; normal.z += n.z;
+        cluster_area += w * 3;
+      }
+
+      center.x += centroid.x; center.y += centroid.y; center.z += centroid.z;
+      area     += cluster_area;
+
+      if (cluster_area > 0) {
+        centroid.x /= cluster_area; centroid.y /= cluster_area; centroid.z /= cluster_area;
+      }
+      centroids[c] = centroid;
+      normals[c]   = normal;
+    }
+    if (area > 0) {
+      center.x /= area; center.y /= area; center.z /= area;
+    }
+
+    for(size_t c = 0; c < clusters_count; c++) {
+      const lgl_3f_t n = normals[c];
+      const float    length = sqrtf(n.x * n.x + n.y * n.y + n.z * n.z);
+      clusters[c].key = length > 0 ? (
+          (centroids[c].x - center.x) * n.x +
+          (centroids[c].y - center.y) * n.y +
+          (centroids[c].z - center.z) * n.z) / length : 0;
+    }
+    free(centroids);
+    free(normals);
+
+    qsort(clusters, clusters_count, sizeof(*clusters), lgl__mesh_cluster_compare);
+
+    uint32_t *output = malloc(triangle_count * 3 * sizeof(*output));
+    for(size_t c = 0, out = 0; c < clusters_count; c++) {
+      const size_t count = clusters[c].count * 3;
+      memcpy(&output[out], &indices[clusters[c].first * 3], count * sizeof(*output));
+      out += count;
+    }
+    memcpy(indices, output, triangle_count * 3 * sizeof(*indices));
+    free(output);
+  }
+
+  free(clusters);
+}
+
+/*-- vertex fetch ----------------------------------------------------------*/
+
+size_t lgl_mesh_optimize_fetch(
+    const size_t  index_count,
+    uint32_t     *indices,
+    const size_t  vertex_count,
+    lgl_vertex_t *vertices) {
+
+  uint32_t     *remap    = malloc(vertex_count * sizeof(*remap));
+  lgl_vertex_t *reordered = malloc(vertex_count * sizeof(*reordered));
+  memset(remap, 0xFF, vertex_count * sizeof(*remap));
+
+  size_t count = 0;
+  for(size_t i = 0; i < index_count; i++) {
+    const uint32_t v = indices[i];
+    if (remap[v] == UINT32_MAX) {
+      remap[v]           = count;
+      reordered[count++] = vertices[v];
+    }
+    indices[i] = remap[v];
+  }
+
+  memcpy(vertices, reordered, count * sizeof(*vertices));
+  free(remap);
+  free(reordered);
+  return count;
+}
+
+/*-- simplification --------------------------------------------------------*/
+
+/*Sum of squared distances to planes, scaled by their triangles' areas.
+  weight is the summed area, dividing by it gives a squared distance.*/
+typedef struct {
+  double         a2, b2, c2, d2;
+  double         ab, ac, ad;
+  double         bc, bd, cd;
+  double         weight;
+} lgl__quadric_t;
+
+static inline void lgl__quadric_add(lgl__quadric_t *q, const lgl__quadric_t *other) {
+  q->a2 += other->a2; q->b2 += other->b2; q->c2 += other->c2; q->d2 += other->d2;
+  q->ab += other->ab; q->ac += other->ac; q->ad += other->ad;
+  q->bc += other->bc; q->bd += other->bd; q->cd += other->cd;
+  q->weight += other->weight;
+}
+
+static inline double lgl__quadric_error(const lgl__quadric_t *q, const double *p) {
+  const double x = p[0], y = p[1], z = p[2];
+  const double error =
+    q->a2 * x * x + q->b2 * y * y + q->c2 * z * z + q->d2 +
+    2 * (q->ab * x * y + q->ac * x * z + q->bc * y * z) +
+    2 * (q->ad * x + q->bd * y + q->cd * z);
+  return q->weight > 0 ? fabs(error) / q->weight : 0;
+}
+
+typedef struct {
+  float          cost;         // squared distance
+  uint32_t       from;
+  uint32_t       to;
+} lgl__mesh_collapse_t;
+
+static int lgl__mesh_collapse_compare(const void *a, const void *b) {
+  const float
+    ca = ((const lgl__mesh_collapse_t*)a)->cost,
+    cb = ((const lgl__mesh_collapse_t*)b)->cost;
+  return (ca > cb) - (ca < cb);
+}
+
+static int lgl__mesh_edge_compare(const void *a, const void *b) {
+  const uint64_t ea = *(const uint64_t*)a, eb = *(const uint64_t*)b;
+  return (ea > eb) - (ea < eb);
+}
+
+static inline void lgl__mesh_cross(const double *a, const double *b, const double *c, double *n) {
+  const double
+    e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] },
+    e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+  n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+  n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+  n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+/*Whether moving from onto to turns any triangle of from that survives the
+  collapse by more than about 75 degrees, or makes it degenerate*/
+static int lgl__mesh_collapse_flips(
+    const uint32_t *indices,
+    const uint32_t *triangles,
+    const uint32_t  triangles_count,
+    const double   *positions,
+    const uint32_t  from,
+    const uint32_t  to) {
+  for(uint32_t i = 0; i < triangles_count; i++) {
+    const uint32_t *triangle = &indices[triangles[i] * 3];
+    if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+      continue; // collapses away
+    }
+
+    const double *corners[3], *moved[3];
+    for(int j = 0; j < 3; j++) {
+      corners[j] = &positions[triangle[j] * 3];
+      moved[j]   = triangle[j] == from ? &positions[to * 3] : corners[j];
+    }
+
+    double before[3], after[3];
+    lgl__mesh_cross(corners[0], corners[1], corners[2], before);
+    lgl__mesh_cross(moved[0],   moved[1],   moved[2],   after);
+
+    const double
+      dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2],
+      lengths = sqrt(
+          (before[0] * before[0] + before[1] * before[1] + before[2] * before[2]) *
+          (after[0]  * after[0]  + after[1]  * after[1]  + after[2]  * after[2]));
+    if (dot <= 0.25 * lengths) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+size_t lgl_mesh_simplify(
+    const size_t        index_count,
+    const uint32_t     *indices,
+    const size_t        vertex_count,
+    const lgl_vertex_t *vertices,
+    const size_t        target_index_count,
+    const float         target_error,
+    uint32_t           *simplified,
+    float              *error) {
+
+  size_t count = index_count - index_count % 3;
+  memcpy(simplified, indices, count * sizeof(*simplified));
+
+  double max_cost = 0;
+
+  // positions relative to the box, in units of its diagonal, so errors are
+  // fractions of the mesh's size
+  double *positions = malloc(vertex_count * 3 * sizeof(*positions)); {
+    lgl_3f_t min = { INFINITY, INFINITY, INFINITY }, max = { -INFINITY, -INFINITY, -INFINITY };
+    for(size_t i = 0; i < count; i++) {
+      const lgl_3f_t p = vertices[simplified[i]].position;
+      min.x = fminf(min.x, p.x); max.x = fmaxf(max.x, p.x);
+      min.y = fminf(min.y, p.y); max.y = fmaxf(max.y, p.y);
+      min.z = fminf(min.z, p.z); max.z = fmaxf(max.z, p.z);
+    }
+    const double diagonal = count ? sqrt(
+        (double)(max.x - min.x) * (max.x - min.x) +
+        (double)(max.y - min.y) * (max.y - min.y) +
+        (double)(max.z - min.z) * (max.z - min.z)) : 0;
+    const double scale = diagonal > 0 ? 1 / diagonal : 1;
+
+    for(size_t v = 0; v < vertex_count; v++) {
+      positions[v * 3 + 0] = (vertices[v].position.x - min.x) * scale;
+      positions[v * 3 + 1] = (vertices[v].position.y - min.y) * scale;
+      positions[v * 3 + 2] = (vertices[v].position.z - min.z) * scale;
+    }
+  }
+
+  lgl__quadric_t *quadrics = calloc(vertex_count, sizeof(*quadrics));
+  for(size_t t = 0; t < count / 3; t++) {
+    const uint32_t *triangle = &simplified[t * 3];
+
+    double n[3];
+    lgl__mesh_cross(&positions[triangle[0] * 3], &positions[triangle[1] * 3],
+        &positions[triangle[2] * 3], n);
+    const double length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    if (length == 0) {
+      continue;
+    }
+
+    const double a = n[0] / length, b = n[1] / length, c = n[2] / length;
+    const double d = -(a * positions[triangle[0] * 3 + 0] +
+                       b * positions[triangle[0] * 3 + 1] +
+                       c * positions[triangle[0] * 3 + 2]);
+    const double w = length * 0.5;
+
+    const lgl__quadric_t plane = {
+      a * a * w, b * b * w, c * c * w, d * d * w,
+      a * b * w, a * c * w, a * d * w,
+      b * c * w, b * d * w, c * d * w,
+      w,
+    };
+    for(int i = 0; i < 3; i++) {
+      lgl__quadric_add(&quadrics[triangle[i]], &plane);
+    }
+  }
+
+  // edges used by one triangle are open borders, or seams where welding
+  // kept vertices with other normals or texture coordinates apart. their
+  // vertices stay put so the outline and the seams do not crack
+  uint8_t *locked = calloc(vertex_count, sizeof(*locked)); {
+    uint64_t *edges = malloc(count * sizeof(*edges));
+    for(size_t i = 0; i < count; i++) {
+      const uint32_t
+        a = simplified[i],
+        b = simplified[i - i % 3 + (i + 1) % 3];
+      edges[i] = a < b ? (uint64_t)a << 32 | b : (uint64_t)b << 32 | a;
+    }
+    qsort(edges, count, sizeof(*edges), lgl__mesh_edge_compare);
+
+    for(size_t i = 0; i < count;) {
+      size_t run = 1;
+      while (i + run < count && edges[i + run] == edges[i]) {
+        run++;
+      }
+      if (run != 2) {
+        locked[edges[i] >> 32] = locked[edges[i] & UINT32_MAX] = 1;
+      }
+      i += run;
+    }
+    free(edges);
+  }
+
+  lgl__mesh_collapse_t *collapses = malloc(count * 2 * sizeof(*collapses));
+  uint32_t *offsets   = malloc((vertex_count + 1) * sizeof(*offsets));
+  uint32_t *adjacency = malloc(count * sizeof(*adjacency));
+  uint32_t *remap     = malloc(vertex_count * sizeof(*remap));
+  uint8_t  *touched   = malloc(vertex_count * sizeof(*touched));
+
+  const double limit = (double)target_error * target_error;
+
+  // each pass collapses the cheapest edges that do not share a
+  // neighbourhood, then rebuilds what changed
+  while (count > target_index_count) {
+    const size_t triangle_count = count / 3;
+
+    memset(offsets, 0, (vertex_count + 1) * sizeof(*offsets));
+    for(size_t i = 0; i < count; i++) {
+      offsets[simplified[i] + 1]++;
+    }
+    for(size_t v = 0; v < vertex_count; v++) {
+      offsets[v + 1] += offsets[v];
+    }
+    for(size_t i = 0; i < count; i++) {
+      adjacency[offsets[simplified[i]]++] = i / 3;
+    }
+    for(size_t v = vertex_count; v > 0; v--) { // back to the starts
+      offsets[v] = offsets[v - 1];
+    }
+    offsets[0] = 0;
+
+    size_t collapses_count = 0;
+    for(size_t i = 0; i < count; i++) {
+      const uint32_t
+        a = simplified[i],
+        b = simplified[i - i % 3 + (i + 1) % 3];
+      for(int direction = 0; direction < 2; direction++) {
+        const uint32_t from = direction ? b : a, to = direction ? a : b;
+        if (locked[from]) {
+          continue;
+        }
+        lgl__quadric_t q = quadrics[from];
+        lgl__quadric_add(&q, &quadrics[to]);
+        collapses[collapses_count++] = (lgl__mesh_collapse_t) {
+          lgl__quadric_error(&q, &positions[to * 3]), from, to,
+        };
+      }
+    }
+    qsort(collapses, collapses_count, sizeof(*collapses), lgl__mesh_collapse_compare);
+
+    for(size_t v = 0; v < vertex_count; v++) {
+      remap[v] = v;
+    }
+    memset(touched, 0, vertex_count * sizeof(*touched));
+
+    // a collapse removes the one or two triangles on its edge
+    const size_t goal = (count - target_index_count + 2) / 3;
+    size_t removed = 0, applied = 0;
+
+    for(size_t c = 0; c < collapses_count && removed < goal; c++) {
+      const lgl__mesh_collapse_t *collapse = &collapses[c];
+      if (collapse->cost > limit) {
+        break;
+      }
+      if (touched[collapse->from] || touched[collapse->to]) {
+        continue;
+      }
+
+      const uint32_t *triangles = &adjacency[offsets[collapse->from]];
+      const uint32_t  triangles_count = offsets[collapse->from + 1] - offsets[collapse->from];
+      if (lgl__mesh_collapse_flips(simplified, triangles, triangles_count,
+            positions, collapse->from, collapse->to)) {
+        continue;
+      }
+
+      for(uint32_t i = 0; i < triangles_count; i++) {
+        const uint32_t *triangle = &simplified[triangles[i] * 3];
+        touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = 1;
+        removed += triangle[0] == collapse->to || triangle[1] == collapse->to ||
+                   triangle[2] == collapse->to;
+      }
+
+      remap[collapse->from] = collapse->to;
+      lgl__quadric_add(&quadrics[collapse->to], &quadrics[collapse->from]);
+      max_cost = fmax(max_cost, collapse->cost);
+      applied++;
+    }
+
+    if (applied == 0) {
+      break;
+    }
+
+    size_t out = 0;
+    for(size_t t = 0; t < triangle_count; t++) {
+      const uint32_t
+        a = remap[simplified[t * 3 + 0]],
+        b = remap[simplified[t * 3 + 1]],
+        c = remap[simplified[t * 3 + 2]];
+      if (a != b && b != c && c != a) {
+        simplified[out++] = a;
+        simplified[out++] = b;
+        simplified[out++] = c;
+      }
+    }
+    count = out;
+  }
+
+  free(positions);
+  free(quadrics);
+  free(locked);
+  free(collapses);
+  free(offsets);
+  free(adjacency);
+  free(remap);
+  free(touched);
+
+  if (error) {
+    *error = sqrt(max_cost);
+  }
+  return count;
+}
@@ -0,0 +1,91 @@
+/*--------------------------------------------------------------------------/
+/                                                                           /
+/ lgl_mesh.h                                                                /
+/ Mesh processing that needs no GL context                                  /
+/                                                                           /
+/--------------------------------------------------------------------------*/
+
+#ifndef LGL_MESH_H
+#define LGL_MESH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif // ifdef __cplusplus
+
+#include "lgl.h"
+
+#ifndef LGL_MESH_CACHE_SIZE
+#define LGL_MESH_CACHE_SIZE 32 // post-transform cache entries lgl_mesh_optimize_cache models
+#endif // ifndef LGL_MESH_CACHE_SIZE
+
+/*Merges bitwise identical vertices. Writes the unique vertices to unique,
+  which must hold vertex_count of them, and one index per input vertex to
+  indices. Returns how many vertices are unique.*/
+size_t lgl_mesh_weld          (const size_t        vertex_count,
+                               const lgl_vertex_t *vertices,
+                               lgl_vertex_t       *unique,
+                               uint32_t           *indices);
+
+/*Reorders the triangles of an index list so consecutive triangles reuse
+  vertices still in the post-transform cache, after Tom Forsyth's "Linear
+  speed vertex cache optimisation". Every index must be below vertex_count.*/
+void   lgl_mesh_optimize_cache(const size_t index_count,
+                               uint32_t    *indices,
+                               const size_t vertex_count);
+
+/*Packs vertices into lgl_vertex_packed_t, positions relative to bounds*/
+void   lgl_mesh_quantize      (const size_t         vertex_count,
+                               const lgl_vertex_t  *vertices,
+                               const lgl_bounds_t  *bounds,
+                               lgl_vertex_packed_t *packed);
+
+/*Average cache miss ratio, misses per triangle of a FIFO post-transform
+  cache of LGL_MESH_CACHE_SIZE entries. 3 is the worst, 0.5 about the best
+  a regular grid can do.*/
+float  lgl_mesh_acmr          (const size_t    index_count,
+                               const uint32_t *indices,
+                               const size_t    vertex_count);
+
+/*Reorders cache ordered triangles to draw less overdraw, after Sander et
+  al. "Fast triangle reordering for vertex locality and reduced overdraw".
+  The triangles are cut into clusters wherever a cluster's own miss ratio
+  is within threshold times the whole mesh's, 1.05 is a good start, and
+  clusters facing away from the mesh center are drawn first since they
+  tend to be in front from any view.*/
+void   lgl_mesh_optimize_overdraw(const size_t        index_count,
+                                  uint32_t           *indices,
+                                  const size_t        vertex_count,
+                                  const lgl_vertex_t *vertices,
+                                  const float         threshold);
+
+/*Renumbers vertices in the order indices first use them, so vertex fetch
+  walks the buffer forwards. Rewrites both arrays in place and drops unused
+  vertices. Returns how many vertices are left.*/
+size_t lgl_mesh_optimize_fetch(const size_t  index_count,
+                               uint32_t     *indices,
+                               const size_t  vertex_count,
+                               lgl_vertex_t *vertices);
+
+/*Collapses edges in order of their quadric error, after Garland and
+  Heckbert's "Surface simplification using quadric error metrics", until
+  at most target_index_count indices are left or the next collapse would
+  move the surface further than target_error. Errors are fractions of the
+  mesh's bounding box diagonal. Vertices only move onto a neighbour, so the
+  result indexes the same vertex array, and vertices on open borders or
+  seams never move. Writes to simplified, which must hold index_count
+  indices, and returns how many it wrote. error, unless NULL, gets the
+  largest error of a collapse that was made.*/
+size_t lgl_mesh_simplify      (const size_t        index_count,
+                               const uint32_t     *indices,
+                               const size_t        vertex_count,
+                               const lgl_vertex_t *vertices,
+                               const size_t        target_index_count,
+                               const float         target_error,
+                               uint32_t           *simplified,
+                               float              *error);
+
+#ifdef __cplusplus
+}
+#endif // ifdef __cplusplus
+
+#endif // LGL_MESH_H
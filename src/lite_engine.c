@@ -83,6 +83,7 @@ void lite_engine_free(lite_engine_context_t *engine) {
 }
 
 void lite_engine_end_frame(lite_engine_context_t *engine) {
+  lgl_end_frame();
   x_end_frame((x_data_t*)engine->platform_data);
   lite_engine__time_update(engine);
 }
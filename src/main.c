@@ -1,6 +1,7 @@
 #include "lite_engine.h"
 #include "platform_x11.h"
 #include "lgl.h"
+#include "lgl_bvh.h"
 
 int main() {
   lite_engine_context_t *engine = lite_engine_start();
@@ -17,6 +18,18 @@ int main() {
     shader_phong = lgl_shader_link(vertex_shader, fragment_shader);
   }
 
+  GLuint shader_phong_instanced = 0; {
+    GLuint vertex_shader = lgl_shader_compile(
+        "res/shaders/phong_instanced_vertex.glsl",
+        GL_VERTEX_SHADER);
+
+    GLuint fragment_shader = lgl_shader_compile(
+        "res/shaders/phong_fragment.glsl",
+        GL_FRAGMENT_SHADER);
+
+    shader_phong_instanced = lgl_shader_link(vertex_shader, fragment_shader);
+  }
+
   GLuint shader_solid = 0; {
     GLuint vertex_shader = lgl_shader_compile(
         "res/shaders/solid_vertex.glsl",
@@ -30,6 +43,9 @@ int main() {
   }
 
   lgl_frame_t frame = lgl_frame_alloc();
+
+  lgl_camera_t camera = lgl_camera_alloc();
+  camera.position.z = -1;
   //frame.render_flags |= LGL_FLAG_USE_WIREFRAME;
 
   enum {
@@ -42,6 +58,7 @@ int main() {
   enum {
     OBJECTS_FLOOR,
     OBJECTS_CUBE,
+    OBJECTS_MODEL,
     OBJECTS_COUNT  // this should ALWAYS be at the end of the enum,
   };
   lgl_render_data_t objects [OBJECTS_COUNT] = {0};
@@ -72,41 +89,89 @@ int main() {
     .specular       = lgl_3f_one(0.6),
   };
 
+  // decoded on worker threads, the scene starts drawing with placeholders
   GLuint
-    texture_diffuse  = lgl_texture_alloc("res/textures/test.png"),
-    texture_cube     = lgl_texture_alloc("res/textures/lite-engine-cube.png"),
-    texture_specular = lgl_texture_alloc("res/textures/default_specular.png");
+    texture_diffuse  = lgl_texture_alloc_async("res/textures/test.ktx"),
+    texture_cube     = lgl_texture_alloc_async("res/textures/lite-engine-cube.ktx"),
+    texture_specular = lgl_texture_alloc_async("res/textures/default_specular.ktx");
 
   objects[OBJECTS_FLOOR] = lgl_cube_alloc(); {
     objects[OBJECTS_FLOOR].shader        =  shader_phong;
     objects[OBJECTS_FLOOR].diffuse_map   =  texture_diffuse;
     objects[OBJECTS_FLOOR].specular_map  =  texture_specular;
     objects[OBJECTS_FLOOR].texture_scale =  lgl_2f_one(10.0);
-    objects[OBJECTS_FLOOR].position.y    = -1;
-    objects[OBJECTS_FLOOR].scale         =  (lgl_3f_t) {10, 1, 10};
-    objects[OBJECTS_FLOOR].lights_count  =  LIGHTS_COUNT;
-    objects[OBJECTS_FLOOR].lights        =  lights;
-    objects[OBJECTS_FLOOR].frame         = &frame;
+    lgl_transform_position_set(objects[OBJECTS_FLOOR].transform, lgl_3f_down(1.0));
+    lgl_transform_scale_set   (objects[OBJECTS_FLOOR].transform, (lgl_3f_t) {10, 1, 10});
   }
 
   objects[OBJECTS_CUBE] = lgl_cube_alloc(); {
     objects[OBJECTS_CUBE].shader         =  shader_phong;
     objects[OBJECTS_CUBE].diffuse_map    =  texture_cube;
-    objects[OBJECTS_CUBE].position.z     =  1;
-    objects[OBJECTS_CUBE].lights_count   =  LIGHTS_COUNT;
-    objects[OBJECTS_CUBE].lights         =  lights;
     objects[OBJECTS_CUBE].render_flags  |=  LGL_FLAG_USE_STENCIL;
-    objects[OBJECTS_CUBE].frame          = &frame;
+    lgl_transform_position_set(objects[OBJECTS_CUBE].transform, lgl_3f_forward(1.0));
+  }
+
+  if (lgl_lmod_alloc("res/models/untitled.lmod", LGL_VERTEX_FORMAT_FLOAT,
+        1, &objects[OBJECTS_MODEL])) {
+    objects[OBJECTS_MODEL].shader        =  shader_phong;
+    objects[OBJECTS_MODEL].diffuse_map   =  texture_diffuse;
+    objects[OBJECTS_MODEL].specular_map  =  texture_specular;
+    lgl_transform_position_set(objects[OBJECTS_MODEL].transform, (lgl_3f_t) {-2, 0, 2});
+    lgl_transform_scale_set   (objects[OBJECTS_MODEL].transform, lgl_3f_one(0.5));
   }
 
+  // a ring of cubes that share the cube mesh, drawn with a single instanced call.
+  // they are children of one pivot, so turning the pivot turns the ring
+  lgl_transform_t pillars_pivot = lgl_transform_alloc();
+  lgl_transform_position_set(pillars_pivot, lgl_3f_forward(1.0));
+
+  enum { PILLARS_COUNT = 8 };
+  lgl_render_data_t pillars [PILLARS_COUNT] = {0};
+
+  for(int i = 0; i < PILLARS_COUNT; i++) {
+    const float angle = i * (2 * 3.14159 / PILLARS_COUNT);
+    pillars[i] = lgl_cube_alloc(); {
+      pillars[i].shader       =  shader_phong_instanced;
+      pillars[i].diffuse_map  =  texture_cube;
+      pillars[i].specular_map =  texture_specular;
+    }
+    lgl_transform_parent_set  (pillars[i].transform, pillars_pivot);
+    lgl_transform_scale_set   (pillars[i].transform, lgl_3f_one(0.25));
+    lgl_transform_position_set(pillars[i].transform,
+        (lgl_3f_t) { cos(angle) * 3, -0.375, sin(angle) * 3 });
+  }
+
+  lgl_draw_queue_t draw_queue = lgl_draw_queue_alloc(OBJECTS_COUNT);
+
+  // the scene's objects go in a bvh, the moving cube is refit every frame
+  lgl_transforms_update();
+  lgl_bvh_t objects_bvh = lgl_bvh_alloc(OBJECTS_COUNT, objects);
+  uint32_t  objects_visible [OBJECTS_COUNT] = {0};
+
   while(engine->is_running) {
     { // update
-      objects[OBJECTS_CUBE].position.y = cos(engine->time_current)*0.2 + 0.5;
+      lgl_texture_uploads_process(0.002f);
+
+      lgl_transform_position_set(objects[OBJECTS_CUBE].transform,
+          (lgl_3f_t) { 0, cos(engine->time_current)*0.2 + 0.5, 1 });
+
+      lgl_transforms_update();
+      const uint32_t moved [] = { OBJECTS_CUBE };
+      lgl_bvh_refit(&objects_bvh, 1, moved, objects);
+
+      const float pivot_angle = engine->time_current * 0.25;
+      lgl_transform_rotation_set(pillars_pivot,
+          (lgl_4f_t) { 0, sin(pivot_angle * 0.5), 0, cos(pivot_angle * 0.5) });
 
       lights[LIGHTS_POINT_0].position.x = sin(engine->time_current);
       lights[LIGHTS_POINT_0].position.z = cos(engine->time_current);
       lights[LIGHTS_POINT_1].position.x = cos(engine->time_current);
       lights[LIGHTS_POINT_1].position.z = sin(engine->time_current);
+
+      lgl_lights_upload(LIGHTS_COUNT, lights);
+
+      camera.aspect = frame.width / frame.height;
+      lgl_camera_update(&camera);
     }
 
     { // draw scene to the frame
@@ -118,8 +183,15 @@ int main() {
           GL_DEPTH_BUFFER_BIT |
           GL_STENCIL_BUFFER_BIT);
 
-      lgl_draw(OBJECTS_COUNT, objects);
+      const size_t visible_count = lgl_bvh_query_frustum(
+          &objects_bvh, camera.frustum, objects_visible, OBJECTS_COUNT);
+      lgl_draw_queue_submit_indices(&draw_queue, visible_count, objects_visible, objects);
+      lgl_draw_queue_flush(&draw_queue);
+      lgl_draw_instanced(PILLARS_COUNT, pillars);
       lgl_outline(1, &objects[OBJECTS_CUBE], shader_solid, 0.01);
+
+      // depth for occlusion culling on the next frames
+      lgl_occlusion_capture(&frame);
     }
 
     { // draw frame to the screen
@@ -135,6 +207,33 @@ int main() {
 
       lite_engine_end_frame(engine);
     }
+
+    { // per-frame renderer statistics
+#if 0 // log stats
+      lgl_stats_t stats = lgl_stats_get();
+      debug_log("draw_calls: %lu, uniform_lookups: %lu, redundant_state_calls: %lu, "
+          "objects_visible: %lu, objects_culled: %lu, objects_occluded: %lu",
+          stats.draw_calls,
+          stats.uniform_lookups,
+          stats.redundant_state_calls,
+          stats.objects_visible,
+          stats.objects_culled,
+          stats.objects_occluded);
+#endif // log stats
+      lgl_stats_reset();
+    }
+  }
+
+  lgl_texture_loader_free();
+  lgl_pixel_buffers_free();
+  lgl_bvh_free(&objects_bvh);
+  lgl_draw_queue_free(&draw_queue);
+
+  for(int i = 0; i < OBJECTS_COUNT; i++) {
+    lgl_render_data_free(&objects[i]);
+  }
+  for(int i = 0; i < PILLARS_COUNT; i++) {
+    lgl_render_data_free(&pillars[i]);
   }
 
   glDeleteFramebuffers(1, &frame.frame_buffer);
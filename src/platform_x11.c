@@ -3,6 +3,17 @@
 #include <stdlib.h>
 #include <stdio.h>
 
+static int x__context_error = 0;
+
+/*Context creation reports unsupported versions through X errors, which would
+  otherwise terminate the program*/
+static int x__context_error_handler(Display *display, XErrorEvent *event) {
+  (void)display;
+  (void)event;
+  x__context_error = 1;
+  return 0;
+}
+
 void x__viewport_size_callback(
     const unsigned int width,
     const unsigned int height) {
@@ -81,15 +92,38 @@ x_data_t *x_start(const char *window_title,
   int num_fbc = 0;
   GLXFBConfig *fb_config = glXChooseFBConfig(x->display, x->screen, visual_attributes, &num_fbc);
 
-  GLint context_attributes[] = {
-    GLX_CONTEXT_MAJOR_VERSION_ARB, 3,
-    GLX_CONTEXT_MINOR_VERSION_ARB, 3,
-    GLX_CONTEXT_PROFILE_MASK_ARB, GLX_CONTEXT_CORE_PROFILE_BIT_ARB,
-    None
+  // ask for the newest core profile the driver supports, down to 3.3
+  static const int gl_versions[][2] = {
+    { 4, 6 }, { 4, 5 }, { 4, 4 }, { 4, 3 }, { 4, 2 }, { 4, 1 }, { 4, 0 }, { 3, 3 },
   };
 
-  x->glx_context = glXCreateContextAttribsARB(
-      x->display, fb_config[0], NULL, 1, context_attributes);
+  int (*error_handler)(Display*, XErrorEvent*) = XSetErrorHandler(x__context_error_handler);
+
+  x->glx_context = NULL;
+  for(size_t i = 0; i < sizeof(gl_versions) / sizeof(*gl_versions); i++) {
+    GLint context_attributes[] = {
+      GLX_CONTEXT_MAJOR_VERSION_ARB, gl_versions[i][0],
+      GLX_CONTEXT_MINOR_VERSION_ARB, gl_versions[i][1],
+      GLX_CONTEXT_PROFILE_MASK_ARB, GLX_CONTEXT_CORE_PROFILE_BIT_ARB,
+      None
+    };
+
+    x__context_error = 0;
+    x->glx_context = glXCreateContextAttribsARB(
+        x->display, fb_config[0], NULL, 1, context_attributes);
+    XSync(x->display, False);
+
+    if (x->glx_context && !x__context_error) {
+      break;
+    }
+
+    if (x->glx_context) {
+      glXDestroyContext(x->display, x->glx_context);
+      x->glx_context = NULL;
+    }
+  }
+
+  XSetErrorHandler(error_handler);
 
   XFree(fb_config);
 
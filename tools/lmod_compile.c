@@ -0,0 +1,82 @@
+/*--------------------------------------------------------------------------/
+/                                                                           /
+/ lmod_compile.c                                                            /
+/ Compiles .lmod meshes into .lmodb files the engine maps and uploads       /
+/                                                                           /
+/--------------------------------------------------------------------------*/
+
+#include "lgl_lmod.h"
+
+static void usage(void) {
+  fprintf(stderr,
+      "usage: lmod_compile [-f float|packed] input.lmod output.lmodb\n"
+      "  -f format  vertex format the file stores, see LGL_VERTEX_FORMAT_*.\n"
+      "             packed is half the size but quantizes positions to the\n"
+      "             mesh's bounds. defaults to float\n");
+}
+
+int main(int argc, char **argv) {
+  GLint vertex_format = LGL_VERTEX_FORMAT_FLOAT;
+
+  const char *paths[2];
+  int         paths_count = 0;
+
+  for(int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+      i++;
+      if (strcmp(argv[i], "float") == 0) {
+        vertex_format = LGL_VERTEX_FORMAT_FLOAT;
+      } else if (strcmp(argv[i], "packed") == 0) {
+        vertex_format = LGL_VERTEX_FORMAT_PACKED;
+      } else {
+        usage();
+        return 1;
+      }
+    } else if (argv[i][0] != '-' && paths_count < 2) {
+      paths[paths_count++] = argv[i];
+    } else {
+      usage();
+      return 1;
+    }
+  }
+  if (paths_count != 2) {
+    usage();
+    return 1;
+  }
+
+  size_t length = 0;
+  char  *text   = lgl_lmod_read(paths[0], &length);
+  if (text == NULL) {
+    return 1;
+  }
+
+  lgl_lmod_t  *meshes = NULL;
+  const size_t meshes_count = lgl_lmod_parse(text, length, &meshes);
+  free(text);
+  if (meshes_count == 0) {
+    debug_error("%s has no meshes", paths[0]);
+    return 1;
+  }
+
+  FILE *output = fopen(paths[1], "wb");
+  if (output == NULL) {
+    debug_error("failed to open %s", paths[1]);
+    lgl_lmod_free(meshes_count, meshes);
+    return 1;
+  }
+
+  const int written = lgl_lmodb_write(output, meshes_count, meshes, vertex_format);
+  if (fclose(output) != 0 || !written) {
+    debug_error("failed to write %s", paths[1]);
+    lgl_lmod_free(meshes_count, meshes);
+    return 1;
+  }
+
+  for(size_t i = 0; i < meshes_count; i++) {
+    fprintf(stderr, "%s: %lu vertices, %lu indices, %d levels of detail\n",
+        meshes[i].name, meshes[i].vertex_count, meshes[i].index_count, meshes[i].levels_count);
+  }
+
+  lgl_lmod_free(meshes_count, meshes);
+  return 0;
+}
@@ -0,0 +1,169 @@
+/*--------------------------------------------------------------------------/
+/                                                                           /
+/ lmod_optimize.c                                                           /
+/ Optimizes .lmod meshes offline and generates their levels of detail      /
+/                                                                           /
+/--------------------------------------------------------------------------*/
+
+#include "lgl_lmod.h"
+#include "lgl_mesh.h"
+
+#define OVERDRAW_THRESHOLD 1.05f // cache misses traded for overdraw, see lgl_mesh_optimize_overdraw
+#define SCREEN_HEIGHT      1080  // screen the -p pixel error is measured on
+#define LEVEL_REDUCTION    0.9f  // a level must keep fewer indices than this of the last one
+
+static void usage(void) {
+  fprintf(stderr,
+      "usage: lmod_optimize [-e error]... [-p pixels] input.lmod output.lmod\n"
+      "  -e error   adds a level of detail simplified until its error reaches\n"
+      "             error, a fraction of the mesh's size. levels are made in\n"
+      "             the order given, at most %d. defaults to 0.01 0.03 0.1\n"
+      "  -p pixels  largest error a level may show on a %d pixel tall screen,\n"
+      "             sets the screen sizes levels switch at. defaults to 1\n",
+      LGL_LOD_MAX - 1, SCREEN_HEIGHT);
+}
+
+/*Radius of the mesh's bounding sphere over its box diagonal. Screen sizes
+  are measured on the sphere, errors on the box.*/
+static float sphere_over_diagonal(const lgl_lmod_t *mesh) {
+  const lgl_bounds_t bounds = lgl_bounds_compute(mesh->vertex_count, mesh->vertices);
+
+  const lgl_3f_t extent = {
+    bounds.max.x - bounds.min.x, bounds.max.y - bounds.min.y, bounds.max.z - bounds.min.z,
+  };
+  const float diagonal = sqrtf(extent.x * extent.x + extent.y * extent.y + extent.z * extent.z);
+  return diagonal > 0 ? bounds.radius / diagonal : 0.5f;
+}
+
+/*Replaces the mesh's levels with its first level and levels simplified
+  from it, all ordered for the vertex cache and overdraw, then orders the
+  vertices for fetch*/
+static void optimize(
+    lgl_lmod_t   *mesh,
+    const size_t  errors_count,
+    const float  *errors,
+    const float   pixels) {
+
+  const lgl_lod_t base = mesh->levels[0];
+  if (base.count == 0) {
+    return;
+  }
+
+  uint32_t *indices = malloc(base.count * LGL_LOD_MAX * sizeof(*indices));
+  memcpy(indices, &mesh->indices[base.first], base.count * sizeof(*indices));
+
+  lgl_lod_t levels[LGL_LOD_MAX] = { { 0, base.count, 0 } };
+  uint8_t   levels_count = 1;
+
+  const float ratio = sphere_over_diagonal(mesh);
+
+  for(size_t e = 0; e < errors_count && levels_count < LGL_LOD_MAX; e++) {
+    const lgl_lod_t *last  = &levels[levels_count - 1];
+    const GLint      first = last->first + last->count;
+
+    float error = 0;
+    const size_t count = lgl_mesh_simplify(last->count, &indices[last->first],
+        mesh->vertex_count, mesh->vertices, 0, errors[e], &indices[first], &error);
+
+    if (count == 0 || count > last->count * LEVEL_REDUCTION) {
+      fprintf(stderr, "  error %g: %lu triangles, too close to the last level, skipped\n",
+          errors[e], count / 3);
+      continue;
+    }
+
+    // the last level is drawn until this one's error would show. an
+    // object's screen size is its sphere's diameter over the screen height
+    error = fmaxf(error, 1e-4f);
+    levels[levels_count - 1].screen_size = pixels * 2 * ratio / (error * SCREEN_HEIGHT);
+    levels[levels_count++] = (lgl_lod_t) { first, count, 0 };
+  }
+
+  for(uint8_t l = 0; l < levels_count; l++) {
+    uint32_t *level = &indices[levels[l].first];
+    const float acmr = lgl_mesh_acmr(levels[l].count, level, mesh->vertex_count);
+
+    lgl_mesh_optimize_cache(levels[l].count, level, mesh->vertex_count);
+    lgl_mesh_optimize_overdraw(levels[l].count, level,
+        mesh->vertex_count, mesh->vertices, OVERDRAW_THRESHOLD);
+
+    fprintf(stderr, "  level %d: %d triangles, acmr %.3f -> %.3f, drawn down to %.4g of the screen\n",
+        l, levels[l].count / 3, acmr,
+        lgl_mesh_acmr(levels[l].count, level, mesh->vertex_count), levels[l].screen_size);
+  }
+
+  // coarser levels use a subset of the first level's vertices, which come first
+  const GLint index_count = levels[levels_count - 1].first + levels[levels_count - 1].count;
+  mesh->vertex_count = lgl_mesh_optimize_fetch(index_count, indices,
+      mesh->vertex_count, mesh->vertices);
+
+  free(mesh->indices);
+  mesh->indices      = indices;
+  mesh->index_count  = index_count;
+  mesh->levels_count = levels_count;
+  memcpy(mesh->levels, levels, sizeof(levels));
+}
+
+int main(int argc, char **argv) {
+  float  errors[LGL_LOD_MAX - 1] = { 0.01f, 0.03f, 0.1f };
+  size_t errors_count = 0;
+  float  pixels       = 1;
+
+  const char *paths[2];
+  int         paths_count = 0;
+
+  for(int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+      if (errors_count == LGL_LOD_MAX - 1) {
+        debug_error("at most %d levels of detail can be generated", LGL_LOD_MAX - 1);
+        return 1;
+      }
+      errors[errors_count++] = atof(argv[++i]);
+    } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+      pixels = atof(argv[++i]);
+    } else if (argv[i][0] != '-' && paths_count < 2) {
+      paths[paths_count++] = argv[i];
+    } else {
+      usage();
+      return 1;
+    }
+  }
+  if (paths_count != 2) {
+    usage();
+    return 1;
+  }
+  if (errors_count == 0) {
+    errors_count = LGL_LOD_MAX - 1;
+  }
+
+  size_t length = 0;
+  char  *text   = lgl_lmod_read(paths[0], &length);
+  if (text == NULL) {
+    return 1;
+  }
+
+  lgl_lmod_t  *meshes = NULL;
+  const size_t meshes_count = lgl_lmod_parse(text, length, &meshes);
+  free(text);
+  if (meshes_count == 0) {
+    debug_error("%s has no meshes", paths[0]);
+    return 1;
+  }
+
+  FILE *output = fopen(paths[1], "w");
+  if (output == NULL) {
+    debug_error("failed to open %s", paths[1]);
+    lgl_lmod_free(meshes_count, meshes);
+    return 1;
+  }
+
+  fprintf(output, "# LMOD file, written by lmod_optimize\n");
+  for(size_t i = 0; i < meshes_count; i++) {
+    fprintf(stderr, "%s: %lu vertices\n", meshes[i].name, meshes[i].vertex_count);
+    optimize(&meshes[i], errors_count, errors, pixels);
+    lgl_lmod_write(output, &meshes[i]);
+  }
+
+  fclose(output);
+  lgl_lmod_free(meshes_count, meshes);
+  return 0;
+}
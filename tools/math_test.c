@@ -0,0 +1,236 @@
+/*--------------------------------------------------------------------------/
+/                                                                           /
+/ math_test.c                                                               /
+/ Checks the lgl_math kernels against the scalar references and times them  /
+/                                                                           /
+/--------------------------------------------------------------------------*/
+
+#include <time.h>
+
+#include "lgl_math.h"
+
+#define COUNT      1027  // not a multiple of 4 or 8, so the batch tails run too
+#define ROUNDS     2000  // times each kernel runs over COUNT items when timed
+
+/*Largest relative difference from the scalar reference that passes. SSE2
+  does the same operations in the same order and matches exactly, FMA skips
+  the rounding between each multiply and add and is off in the last bits,
+  about 2e-7 on these inputs.*/
+#define TOLERANCE  1e-4f
+
+static uint32_t random_state = 1;
+
+/*Uniform in [-1, 1], the same sequence on every run*/
+static float random_float(void) {
+  random_state = random_state * 1664525u + 1013904223u;
+  return (float)(random_state >> 8) / (float)(1u << 23) - 1.0f;
+}
+
+static float max_error = 0;
+static int   failures  = 0;
+
+static void check(const char *kernel, const size_t item, const float *got, const float *expected, const size_t count) {
+  for(size_t i = 0; i < count; i++) {
+    const float magnitude = fabsf(expected[i]) > 1.0f ? fabsf(expected[i]) : 1.0f;
+    const float error     = fabsf(got[i] - expected[i]) / magnitude;
+    if (error > max_error) {
+      max_error = error;
+    }
+    if (!(error <= TOLERANCE)) {
+      debug_error("%s: item %lu element %lu is %g, the scalar reference gives %g",
+          kernel, item, i, got[i], expected[i]);
+      failures++;
+      return;
+    }
+  }
+}
+
+static double seconds(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static volatile float sink; // keeps timed results alive
+
+static void report(const char *kernel, const double start, const double middle, const double end) {
+  const double items = (double)COUNT * ROUNDS;
+  fprintf(stderr, "%-34s %8.2f ns  scalar %8.2f ns  %5.2fx\n", kernel,
+      (middle - start) / items * 1e9, (end - middle) / items * 1e9,
+      (end - middle) / (middle - start));
+}
+
+int main(void) {
+  float    *a                    = malloc(sizeof(float)    * 16);
+  float    *matrices             = malloc(sizeof(float)    * 16 * COUNT);
+  float    *results              = malloc(sizeof(float)    * 16 * COUNT);
+  float    *expected             = malloc(sizeof(float)    * 16 * COUNT);
+  float    *normals              = malloc(sizeof(float)    * 12 * COUNT);
+  float    *expected_normals     = malloc(sizeof(float)    * 12 * COUNT);
+  lgl_4f_t *vectors              = malloc(sizeof(lgl_4f_t) * COUNT);
+  lgl_4f_t *transformed          = malloc(sizeof(lgl_4f_t) * COUNT);
+  lgl_4f_t *expected_transformed = malloc(sizeof(lgl_4f_t) * COUNT);
+  lgl_3f_t *positions            = malloc(sizeof(lgl_3f_t) * COUNT);
+  lgl_4f_t *rotations            = malloc(sizeof(lgl_4f_t) * COUNT);
+  lgl_3f_t *scales               = malloc(sizeof(lgl_3f_t) * COUNT);
+
+  for(size_t i = 0; i < 16; i++) {
+    a[i] = random_float();
+  }
+
+  for(size_t i = 0; i < COUNT; i++) {
+    // a heavy diagonal keeps the upper 3x3 far from singular, so the inverse
+    // transpose stays well conditioned
+    for(size_t j = 0; j < 16; j++) {
+      matrices[i * 16 + j] = random_float() + (j % 5 == 0 ? 3.0f : 0.0f);
+    }
+
+    vectors[i] = (lgl_4f_t) { random_float(), random_float(), random_float(), random_float() };
+
+    positions[i] = (lgl_3f_t) { random_float() * 100, random_float() * 100, random_float() * 100 };
+    scales[i]    = (lgl_3f_t) { random_float() + 1.5f, random_float() + 1.5f, random_float() + 1.5f };
+
+    lgl_4f_t q = { random_float(), random_float(), random_float(), random_float() };
+    const float length = sqrtf(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+    rotations[i] = (lgl_4f_t) { q.x / length, q.y / length, q.z / length, q.w / length };
+  }
+
+  // correctness
+
+  for(size_t i = 0; i < COUNT; i++) {
+    lgl_mat4_multiply       (&results [i * 16], a, &matrices[i * 16]);
+    lgl_mat4_multiply_scalar(&expected[i * 16], a, &matrices[i * 16]);
+    check("lgl_mat4_multiply", i, &results[i * 16], &expected[i * 16], 16);
+  }
+
+  lgl_mat4_multiply_batch(COUNT, results, a, matrices);
+  for(size_t i = 0; i < COUNT; i++) {
+    check("lgl_mat4_multiply_batch", i, &results[i * 16], &expected[i * 16], 16);
+  }
+
+  for(size_t i = 0; i < COUNT; i++) {
+    transformed         [i] = lgl_mat4_transform       (&matrices[i * 16], vectors[i]);
+    expected_transformed[i] = lgl_mat4_transform_scalar(&matrices[i * 16], vectors[i]);
+    check("lgl_mat4_transform", i, &transformed[i].x, &expected_transformed[i].x, 4);
+  }
+
+  lgl_mat4_transform_batch(COUNT, transformed, a, vectors);
+  for(size_t i = 0; i < COUNT; i++) {
+    expected_transformed[i] = lgl_mat4_transform_scalar(a, vectors[i]);
+    check("lgl_mat4_transform_batch", i, &transformed[i].x, &expected_transformed[i].x, 4);
+  }
+
+  for(size_t i = 0; i < COUNT; i++) {
+    lgl_mat3_inverse_transpose       (&normals         [i * 12], &matrices[i * 16]);
+    lgl_mat3_inverse_transpose_scalar(&expected_normals[i * 12], &matrices[i * 16]);
+    check("lgl_mat3_inverse_transpose", i, &normals[i * 12], &expected_normals[i * 12], 12);
+  }
+
+  lgl_mat3_inverse_transpose_batch(COUNT, normals, matrices);
+  for(size_t i = 0; i < COUNT; i++) {
+    check("lgl_mat3_inverse_transpose_batch", i, &normals[i * 12], &expected_normals[i * 12], 12);
+  }
+
+  for(size_t i = 0; i < COUNT; i++) {
+    lgl_mat4_trs       (&results [i * 16], &normals         [i * 12], positions[i], rotations[i], scales[i]);
+    lgl_mat4_trs_scalar(&expected[i * 16], &expected_normals[i * 12], positions[i], rotations[i], scales[i]);
+    check("lgl_mat4_trs",        i, &results[i * 16], &expected        [i * 16], 16);
+    check("lgl_mat4_trs normal", i, &normals[i * 12], &expected_normals[i * 12], 12);
+  }
+
+  lgl_mat4_trs_batch(COUNT, results, normals, positions, rotations, scales);
+  for(size_t i = 0; i < COUNT; i++) {
+    check("lgl_mat4_trs_batch",        i, &results[i * 16], &expected        [i * 16], 16);
+    check("lgl_mat4_trs_batch normal", i, &normals[i * 12], &expected_normals[i * 12], 12);
+  }
+
+  memset(results, 0, sizeof(float) * 16 * COUNT);
+  lgl_mat4_trs_batch(COUNT, results, NULL, positions, rotations, scales);
+  for(size_t i = 0; i < COUNT; i++) {
+    check("lgl_mat4_trs_batch without normals", i, &results[i * 16], &expected[i * 16], 16);
+  }
+
+  fprintf(stderr, "%s kernels: %d failures, largest relative error %g, tolerance %g\n",
+      LGL_MATH_BACKEND, failures, max_error, TOLERANCE);
+
+  // timing, each batch kernel against calling its scalar reference per item,
+  // what a caller without the batch would do
+
+  double start, middle, end;
+
+  start = seconds();
+  for(size_t round = 0; round < ROUNDS; round++) {
+    lgl_mat4_multiply_batch(COUNT, results, a, matrices);
+    sink = results[round % COUNT];
+  }
+  middle = seconds();
+  for(size_t round = 0; round < ROUNDS; round++) {
+    for(size_t i = 0; i < COUNT; i++) {
+      lgl_mat4_multiply_scalar(&results[i * 16], a, &matrices[i * 16]);
+    }
+    sink = results[round % COUNT];
+  }
+  end = seconds();
+  report("lgl_mat4_multiply_batch", start, middle, end);
+
+  start = seconds();
+  for(size_t round = 0; round < ROUNDS; round++) {
+    lgl_mat4_transform_batch(COUNT, transformed, a, vectors);
+    sink = transformed[round % COUNT].x;
+  }
+  middle = seconds();
+  for(size_t round = 0; round < ROUNDS; round++) {
+    for(size_t i = 0; i < COUNT; i++) {
+      transformed[i] = lgl_mat4_transform_scalar(a, vectors[i]);
+    }
+    sink = transformed[round % COUNT].x;
+  }
+  end = seconds();
+  report("lgl_mat4_transform_batch", start, middle, end);
+
+  start = seconds();
+  for(size_t round = 0; round < ROUNDS; round++) {
+    lgl_mat3_inverse_transpose_batch(COUNT, normals, matrices);
+    sink = normals[round % COUNT];
+  }
+  middle = seconds();
+  for(size_t round = 0; round < ROUNDS; round++) {
+    for(size_t i = 0; i < COUNT; i++) {
+      lgl_mat3_inverse_transpose_scalar(&normals[i * 12], &matrices[i * 16]);
+    }
+    sink = normals[round % COUNT];
+  }
+  end = seconds();
+  report("lgl_mat3_inverse_transpose_batch", start, middle, end);
+
+  start = seconds();
+  for(size_t round = 0; round < ROUNDS; round++) {
+    lgl_mat4_trs_batch(COUNT, results, normals, positions, rotations, scales);
+    sink = results[round % COUNT] + normals[round % COUNT];
+  }
+  middle = seconds();
+  for(size_t round = 0; round < ROUNDS; round++) {
+    for(size_t i = 0; i < COUNT; i++) {
+      lgl_mat4_trs_scalar(&results[i * 16], &normals[i * 12],
+          positions[i], rotations[i], scales[i]);
+    }
+    sink = results[round % COUNT] + normals[round % COUNT];
+  }
+  end = seconds();
+  report("lgl_mat4_trs_batch", start, middle, end);
+
+  free(a);
+  free(matrices);
+  free(results);
+  free(expected);
+  free(normals);
+  free(expected_normals);
+  free(vectors);
+  free(transformed);
+  free(expected_transformed);
+  free(positions);
+  free(rotations);
+  free(scales);
+
+  return failures != 0;
+}
@@ -0,0 +1,156 @@
+/*--------------------------------------------------------------------------/
+/                                                                           /
+/ texture_bake.c                                                            /
+/ Bakes images into block compressed .ktx textures with their mip chains    /
+/                                                                           /
+/--------------------------------------------------------------------------*/
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "lgl_ktx.h"
+
+static void usage(void) {
+  fprintf(stderr,
+      "usage: texture_bake [-f auto|bc1|bc3|bc7|rgba8] input.png output.ktx\n"
+      "  -f format  block compression the texture is stored in. auto, the\n"
+      "             default, picks bc1 for opaque images and bc3 otherwise.\n"
+      "             bc7 looks better but needs GL 4.2 or\n"
+      "             ARB_texture_compression_bptc to load without decoding\n");
+}
+
+/*Halves an RGBA8 image with a box filter, down to 1 on each side. On odd
+  sides the last texel is folded into the one before, so the last output
+  texel averages three instead of two.*/
+static void downsample(
+    const uint32_t width,
+    const uint32_t height,
+    const uint8_t *rgba,
+    uint8_t       *half) {
+  const uint32_t half_width  = width  > 1 ? width  / 2 : 1;
+  const uint32_t half_height = height > 1 ? height / 2 : 1;
+
+  for(uint32_t y = 0; y < half_height; y++) {
+    const uint32_t rows = height == 1 ? 1 : y == half_height - 1 && height % 2 ? 3 : 2;
+    for(uint32_t x = 0; x < half_width; x++) {
+      const uint32_t columns = width == 1 ? 1 : x == half_width - 1 && width % 2 ? 3 : 2;
+      const uint32_t taps    = rows * columns;
+      for(int c = 0; c < 4; c++) {
+        uint32_t sum = 0;
+        for(uint32_t row = y * 2; row < y * 2 + rows; row++) {
+          for(uint32_t column = x * 2; column < x * 2 + columns; column++) {
+            sum += rgba[((size_t)row * width + column) * 4 + c];
+          }
+        }
+        half[((size_t)y * half_width + x) * 4 + c] = (sum + taps / 2) / taps;
+      }
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  GLenum format = 0; // auto
+
+  const char *paths[2];
+  int         paths_count = 0;
+
+  for(int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+      i++;
+      if (strcmp(argv[i], "auto") == 0) {
+        format = 0;
+      } else if (strcmp(argv[i], "bc1") == 0) {
+        format = LGL_KTX_BC1;
+      } else if (strcmp(argv[i], "bc3") == 0) {
+        format = LGL_KTX_BC3;
+      } else if (strcmp(argv[i], "bc7") == 0) {
+        format = LGL_KTX_BC7;
+      } else if (strcmp(argv[i], "rgba8") == 0) {
+        format = LGL_KTX_RGBA8;
+      } else {
+        usage();
+        return 1;
+      }
+    } else if (argv[i][0] != '-' && paths_count < 2) {
+      paths[paths_count++] = argv[i];
+    } else {
+      usage();
+      return 1;
+    }
+  }
+  if (paths_count != 2) {
+    usage();
+    return 1;
+  }
+
+  // the engine loads images bottom row first, see lgl_texture_alloc
+  stbi_set_flip_vertically_on_load(1);
+  int      image_width, image_height, channels;
+  uint8_t *image = stbi_load(paths[0], &image_width, &image_height, &channels, 4);
+  if (image == NULL) {
+    debug_error("failed to load %s: %s", paths[0], stbi_failure_reason());
+    return 1;
+  }
+
+  const uint32_t width  = image_width;
+  const uint32_t height = image_height;
+
+  if (format == 0) {
+    format = LGL_KTX_BC1;
+    for(size_t i = 0; i < (size_t)width * height; i++) {
+      if (image[i * 4 + 3] != 255) {
+        format = LGL_KTX_BC3;
+        break;
+      }
+    }
+  }
+
+  uint32_t levels_count = 1;
+  while ((width | height) >> levels_count && levels_count < LGL_KTX_LEVELS_MAX) {
+    levels_count++;
+  }
+
+  const uint8_t *levels[LGL_KTX_LEVELS_MAX];
+  size_t         size = 0;
+  uint8_t       *rgba = image;
+
+  for(uint32_t i = 0; i < levels_count; i++) {
+    const uint32_t level_width  = width  >> i ? width  >> i : 1;
+    const uint32_t level_height = height >> i ? height >> i : 1;
+    const size_t   level_size   = lgl_ktx_size(format, level_width, level_height);
+
+    uint8_t *level = malloc(level_size);
+    lgl_ktx_encode(format, level_width, level_height, rgba, level);
+    levels[i] = level;
+    size     += level_size;
+
+    if (i + 1 < levels_count) {
+      uint8_t *half = malloc((size_t)(level_width > 1 ? level_width / 2 : 1) *
+          (level_height > 1 ? level_height / 2 : 1) * 4);
+      downsample(level_width, level_height, rgba, half);
+      if (rgba != image) {
+        free(rgba);
+      }
+      rgba = half;
+    }
+  }
+  if (rgba != image) {
+    free(rgba);
+  }
+  stbi_image_free(image);
+
+  FILE *output = fopen(paths[1], "wb");
+  int   written = output && lgl_ktx_write(output, format, width, height, levels_count, levels);
+  if (output && fclose(output) != 0) {
+    written = 0;
+  }
+  for(uint32_t i = 0; i < levels_count; i++) {
+    free((void*)levels[i]);
+  }
+  if (!written) {
+    debug_error("failed to write %s", paths[1]);
+    return 1;
+  }
+
+  fprintf(stderr, "%s: %ux%u, %u levels, %lu bytes, %lu uncompressed\n",
+      paths[1], width, height, levels_count, size, (size_t)width * height * 4 * 4 / 3);
+  return 0;
+}